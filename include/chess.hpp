@@ -1197,6 +1197,7 @@ class attacks {
 #include <array>
 #include <cctype>
 #include <optional>
+#include <type_traits>
 
 // check if charconv header is available
 #if __has_include(<charconv>)
@@ -1434,7 +1435,9 @@ class Board;
 
 class movegen {
    public:
-    enum class MoveGenType : std::uint8_t { ALL, CAPTURE, QUIET };
+    // EVASIONS must only be used in check: king moves, and unless in double check the
+    // captures of the checker and the interpositions by unpinned pieces.
+    enum class MoveGenType : std::uint8_t { ALL, CAPTURE, QUIET, EVASIONS };
 
     /**
      * @brief Generates all legal moves for a position.
@@ -1448,6 +1451,29 @@ class movegen {
                            int pieces = PieceGenType::PAWN | PieceGenType::KNIGHT | PieceGenType::BISHOP |
                                         PieceGenType::ROOK | PieceGenType::QUEEN | PieceGenType::KING);
 
+    /**
+     * @brief Generates the legal moves that land on targets, e.g. the recaptures on the square
+     * the last move went to. An en passant capture also counts as landing on the pawn it takes.
+     * Castling is only generated when every square is a target.
+     * @tparam mt
+     * @param movelist
+     * @param board
+     * @param targets
+     * @param pieces
+     */
+    template <MoveGenType mt = MoveGenType::ALL>
+    void static targetmoves(Movelist &movelist, const Board &board, Bitboard targets,
+                            int pieces = PieceGenType::PAWN | PieceGenType::KNIGHT | PieceGenType::BISHOP |
+                                         PieceGenType::ROOK | PieceGenType::QUEEN | PieceGenType::KING);
+
+    /**
+     * @brief Generates the quiet moves that give check, directly or by discovery. The side to
+     * move must not be in check. Castling and pawn pushes to the last rank are left out.
+     * @param movelist
+     * @param board
+     */
+    void static quietchecks(Movelist &movelist, const Board &board);
+
    private:
     static auto init_squares_between();
     static const std::array<std::array<Bitboard, 64>, 64> SQUARES_BETWEEN_BB;
@@ -1466,10 +1492,15 @@ class movegen {
     template <Color::underlying c>
     [[nodiscard]] static Bitboard seenSquares(const Board &board, Bitboard enemy_empty);
 
-    // Generate pawn moves.
+    // Returns the squares of movable_square the king of c can step to. Tests the few squares
+    // next to the king one by one, which in check is cheaper than seenSquares.
+    template <Color::underlying c>
+    [[nodiscard]] static Bitboard safeKingSquares(const Board &board, Square sq, Bitboard movable_square);
+
+    // Generate pawn moves landing on targets. En passant also counts as landing on the pawn it takes.
     template <Color::underlying c, MoveGenType mt>
     static void generatePawnMoves(const Board &board, Movelist &moves, Bitboard pin_d, Bitboard pin_hv,
-                                  Bitboard checkmask, Bitboard occ_enemy);
+                                  Bitboard checkmask, Bitboard occ_enemy, Bitboard targets);
 
     [[nodiscard]] static std::array<Move, 2> generateEPMove(const Board &board, Bitboard checkmask, Bitboard pin_d,
                                                             Bitboard pawns_lr, Square ep, Color c);
@@ -1491,7 +1522,10 @@ class movegen {
     static void whileBitboardAdd(Movelist &movelist, Bitboard mask, T func);
 
     template <Color::underlying c, MoveGenType mt>
-    static void legalmoves(Movelist &movelist, const Board &board, int pieces);
+    static void legalmoves(Movelist &movelist, const Board &board, int pieces, Bitboard targets);
+
+    template <Color::underlying c>
+    static void quietchecks(Movelist &movelist, const Board &board);
 
     template <Color::underlying c>
     static bool isEpSquareValid(const Board &board, Square ep);
@@ -1829,6 +1863,7 @@ class Board {
         std::uint8_t half_moves;
         Piece captured_piece;
 
+        State() = default;
         State(const U64 &hash, const CastlingRights &castling, const Square &enpassant, const std::uint8_t &half_moves,
               const Piece &captured_piece)
             : hash(hash),
@@ -1838,17 +1873,64 @@ class Board {
               captured_piece(captured_piece) {}
     };
 
+    /**
+     * @brief Fixed-capacity history of the states before each move, so that making a move
+     * never allocates. It wraps around once full: isRepetition looks back at most 255 plies,
+     * and unmakeMove can undo at most CAPACITY moves in a row.
+     */
+    class StateHistory {
+       public:
+        static constexpr std::size_t CAPACITY = 256;  // power of two, covers the 255 plies isRepetition looks at
+
+        template <typename... Args>
+        void emplace_back(Args &&...args) {
+            states_[size_++ & (CAPACITY - 1)] = State(std::forward<Args>(args)...);
+        }
+
+        void pop_back() noexcept {
+            assert(size_ > 0);
+            --size_;
+        }
+
+        void clear() noexcept { size_ = 0; }
+
+        [[nodiscard]] const State &back() const noexcept {
+            assert(size_ > 0);
+            return states_[(size_ - 1) & (CAPACITY - 1)];
+        }
+
+        [[nodiscard]] const State &operator[](std::size_t i) const noexcept { return states_[i & (CAPACITY - 1)]; }
+
+        [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+       private:
+        std::array<State, CAPACITY> states_;
+        std::size_t size_ = 0;
+    };
+
     enum class PrivateCtor { CREATE };
 
+   public:
+    /**
+     * @brief Hooks that do nothing, used by the plain Board so that they compile away.
+     * BasicBoard passes its derived class instead.
+     */
+    struct NoHooks {
+        void onPlacePiece(Piece, Square) noexcept {}
+        void onRemovePiece(Piece, Square) noexcept {}
+    };
+
+   private:
+
     // private constructor to avoid initialization
     Board(PrivateCtor) {}
 
    public:
     explicit Board(std::string_view fen = constants::STARTPOS, bool chess960 = false) {
-        prev_states_.reserve(256);
         chess960_ = chess960;
-        assert(setFenInternal<true>(constants::STARTPOS));
-        setFenInternal<true>(fen);
+        NoHooks hooks;
+        assert(setFenInternal<true>(constants::STARTPOS, hooks));
+        setFenInternal<true>(fen, hooks);
     }
 
     static Board fromFen(std::string_view fen) { return Board(fen); }
@@ -1863,7 +1945,10 @@ class Board {
      * @param fen
      * @return
      */
-    virtual bool setFen(std::string_view fen) { return setFenInternal(fen); }
+    bool setFen(std::string_view fen) {
+        NoHooks hooks;
+        return setFenInternal(fen, hooks);
+    }
 
     /**
      * @brief Returns true if the given EPD was successfully parsed and set.
@@ -2009,6 +2094,21 @@ class Board {
      */
     template <bool EXACT = false>
     void makeMove(const Move move) {
+        NoHooks hooks;
+        makeMove<EXACT>(move, hooks);
+    }
+
+    void unmakeMove(const Move move) {
+        NoHooks hooks;
+        unmakeMove(move, hooks);
+    }
+
+   protected:
+    /**
+     * @brief makeMove, reporting every piece placed or removed to hooks.
+     */
+    template <bool EXACT, typename Hooks>
+    void makeMove(const Move move, Hooks &hooks) {
         const auto capture  = at(move.to()) != Piece::NONE && move.typeOf() != Move::CASTLING;
         const auto captured = at(move.to());
         const auto pt       = at<PieceType>(move.from());
@@ -2017,6 +2117,7 @@ class Board {
         assert((at(move.from()) < Piece::BLACKPAWN) == (stm_ == Color::WHITE));
 
         prev_states_.emplace_back(key_, cr_, ep_sq_, hfm_, captured);
+        invalidateCheckInfo();
 
         hfm_++;
         plies_++;
@@ -2025,7 +2126,7 @@ class Board {
         ep_sq_ = Square::NO_SQ;
 
         if (capture) {
-            removePiece(captured, move.to());
+            removePiece(captured, move.to(), hooks);
 
             hfm_ = 0;
             key_ ^= Zobrist::piece(captured, move.to());
@@ -2114,14 +2215,14 @@ class Board {
             const auto king = at(move.from());
             const auto rook = at(move.to());
 
-            removePiece(king, move.from());
-            removePiece(rook, move.to());
+            removePiece(king, move.from(), hooks);
+            removePiece(rook, move.to(), hooks);
 
             assert(king == Piece(PieceType::KING, stm_));
             assert(rook == Piece(PieceType::ROOK, stm_));
 
-            placePiece(king, kingTo);
-            placePiece(rook, rookTo);
+            placePiece(king, kingTo, hooks);
+            placePiece(rook, rookTo, hooks);
 
             key_ ^= Zobrist::piece(king, move.from()) ^ Zobrist::piece(king, kingTo);
             key_ ^= Zobrist::piece(rook, move.to()) ^ Zobrist::piece(rook, rookTo);
@@ -2129,8 +2230,8 @@ class Board {
             const auto piece_pawn = Piece(PieceType::PAWN, stm_);
             const auto piece_prom = Piece(move.promotionType(), stm_);
 
-            removePiece(piece_pawn, move.from());
-            placePiece(piece_prom, move.to());
+            removePiece(piece_pawn, move.from(), hooks);
+            placePiece(piece_prom, move.to(), hooks);
 
             key_ ^= Zobrist::piece(piece_pawn, move.from()) ^ Zobrist::piece(piece_prom, move.to());
         } else {
@@ -2139,8 +2240,8 @@ class Board {
 
             const auto piece = at(move.from());
 
-            removePiece(piece, move.from());
-            placePiece(piece, move.to());
+            removePiece(piece, move.from(), hooks);
+            placePiece(piece, move.to(), hooks);
 
             key_ ^= Zobrist::piece(piece, move.from()) ^ Zobrist::piece(piece, move.to());
         }
@@ -2150,7 +2251,7 @@ class Board {
 
             const auto piece = Piece(PieceType::PAWN, ~stm_);
 
-            removePiece(piece, move.to().ep_square());
+            removePiece(piece, move.to().ep_square(), hooks);
 
             key_ ^= Zobrist::piece(piece, move.to().ep_square());
         }
@@ -2159,7 +2260,11 @@ class Board {
         stm_ = ~stm_;
     }
 
-    void unmakeMove(const Move move) {
+    /**
+     * @brief unmakeMove, reporting every piece placed or removed to hooks.
+     */
+    template <typename Hooks>
+    void unmakeMove(const Move move, Hooks &hooks) {
         const auto &prev = prev_states_.back();
 
         ep_sq_ = prev.enpassant;
@@ -2179,14 +2284,14 @@ class Board {
             const auto rook = at(rook_from_sq);
             const auto king = at(king_to_sq);
 
-            removePiece(rook, rook_from_sq);
-            removePiece(king, king_to_sq);
+            removePiece(rook, rook_from_sq, hooks);
+            removePiece(king, king_to_sq, hooks);
 
             assert(king == Piece(PieceType::KING, stm_));
             assert(rook == Piece(PieceType::ROOK, stm_));
 
-            placePiece(king, move.from());
-            placePiece(rook, move.to());
+            placePiece(king, move.from(), hooks);
+            placePiece(rook, move.to(), hooks);
 
         } else if (move.typeOf() == Move::PROMOTION) {
             const auto pawn  = Piece(PieceType::PAWN, stm_);
@@ -2197,12 +2302,12 @@ class Board {
             assert(piece.type() != PieceType::KING);
             assert(piece.type() != PieceType::NONE);
 
-            removePiece(piece, move.to());
-            placePiece(pawn, move.from());
+            removePiece(piece, move.to(), hooks);
+            placePiece(pawn, move.from(), hooks);
 
             if (prev.captured_piece != Piece::NONE) {
                 assert(at(move.to()) == Piece::NONE);
-                placePiece(prev.captured_piece, move.to());
+                placePiece(prev.captured_piece, move.to(), hooks);
             }
 
         } else {
@@ -2211,8 +2316,8 @@ class Board {
 
             const auto piece = at(move.to());
 
-            removePiece(piece, move.to());
-            placePiece(piece, move.from());
+            removePiece(piece, move.to(), hooks);
+            placePiece(piece, move.from(), hooks);
 
             if (move.typeOf() == Move::ENPASSANT) {
                 const auto pawn   = Piece(PieceType::PAWN, ~stm_);
@@ -2220,11 +2325,11 @@ class Board {
 
                 assert(at(pawnTo) == Piece::NONE);
 
-                placePiece(pawn, pawnTo);
+                placePiece(pawn, pawnTo, hooks);
             } else if (prev.captured_piece != Piece::NONE) {
                 assert(at(move.to()) == Piece::NONE);
 
-                placePiece(prev.captured_piece, move.to());
+                placePiece(prev.captured_piece, move.to(), hooks);
             }
         }
 
@@ -2232,11 +2337,67 @@ class Board {
         prev_states_.pop_back();
     }
 
+   public:
+    /**
+     * @brief Everything makeMove changes apart from the move history. Trivially copyable, so
+     * that a search can save it before a move and restore it instead of calling unmakeMove.
+     */
+    struct alignas(64) Position {
+        std::array<Bitboard, 6> pieces_bb;
+        std::array<Bitboard, 2> occ_bb;
+        std::array<Piece, 64> board;
+        U64 key;
+        U64 pawn_key;
+        U64 material_key;
+        CastlingRights cr;
+        std::uint16_t plies;
+        Color stm;
+        Square ep_sq;
+        std::uint8_t hfm;
+    };
+
+    static_assert(std::is_trivially_copyable_v<Position>);
+
+    void savePosition(Position &position) const noexcept {
+        position.pieces_bb    = pieces_bb_;
+        position.occ_bb       = occ_bb_;
+        position.board        = board_;
+        position.key          = key_;
+        position.pawn_key     = pawn_key_;
+        position.material_key = material_key_;
+        position.cr           = cr_;
+        position.plies        = plies_;
+        position.stm          = stm_;
+        position.ep_sq        = ep_sq_;
+        position.hfm          = hfm_;
+    }
+
+    /**
+     * @brief Undoes the last makeMove or makeNullMove by going back to the Position saved
+     * right before it. No piece is placed or removed, so no hooks are called.
+     * @param position
+     */
+    void restorePosition(const Position &position) noexcept {
+        pieces_bb_    = position.pieces_bb;
+        occ_bb_       = position.occ_bb;
+        board_        = position.board;
+        key_          = position.key;
+        pawn_key_     = position.pawn_key;
+        material_key_ = position.material_key;
+        cr_           = position.cr;
+        plies_        = position.plies;
+        stm_          = position.stm;
+        ep_sq_        = position.ep_sq;
+        hfm_          = position.hfm;
+        prev_states_.pop_back();
+    }
+
     /**
      * @brief Make a null move. (Switches the side to move)
      */
     void makeNullMove() {
         prev_states_.emplace_back(key_, cr_, ep_sq_, hfm_, Piece::NONE);
+        invalidateCheckInfo();
 
         key_ ^= Zobrist::sideToMove();
         if (ep_sq_ != Square::NO_SQ) key_ ^= Zobrist::enpassant(ep_sq_.file());
@@ -2355,6 +2516,19 @@ class Board {
      * @return
      */
     [[nodiscard]] U64 hash() const noexcept { return key_; }
+
+    /**
+     * @brief Get the zobrist hash key of the pawns alone, kept up to date on every pawn placed or removed
+     * @return
+     */
+    [[nodiscard]] U64 pawnKey() const noexcept { return pawn_key_; }
+
+    /**
+     * @brief Get the material signature: the number of pieces of every Piece, 4 bits each,
+     * lowest nibble first. Kept up to date on every piece placed or removed.
+     * @return
+     */
+    [[nodiscard]] U64 materialKey() const noexcept { return material_key_; }
     [[nodiscard]] Color sideToMove() const noexcept { return stm_; }
     [[nodiscard]] Square enpassantSq() const noexcept { return ep_sq_; }
     [[nodiscard]] CastlingRights castlingRights() const noexcept { return cr_; }
@@ -2454,33 +2628,24 @@ class Board {
      * @return
      */
     [[nodiscard]] bool isInsufficientMaterial() const noexcept {
-        const auto count = occ().count();
+        const auto bit = [](Piece piece) { return 1ULL << (4 * static_cast<int>(piece)); };
+
+        // the material key without the kings, a count per piece
+        const auto key = material_key_ - bit(Piece::WHITEKING) - bit(Piece::BLACKKING);
 
         // only kings, draw
-        if (count == 2) return true;
+        if (key == 0) return true;
 
         // only bishop + knight, cant mate
-        if (count == 3) {
-            if (pieces(PieceType::BISHOP, Color::WHITE) || pieces(PieceType::BISHOP, Color::BLACK)) return true;
-            if (pieces(PieceType::KNIGHT, Color::WHITE) || pieces(PieceType::KNIGHT, Color::BLACK)) return true;
-        }
-
-        // same colored bishops, cant mate
-        if (count == 4) {
-            if (pieces(PieceType::BISHOP, Color::WHITE) && pieces(PieceType::BISHOP, Color::BLACK) &&
-                Square::same_color(pieces(PieceType::BISHOP, Color::WHITE).lsb(),
-                                   pieces(PieceType::BISHOP, Color::BLACK).lsb()))
-                return true;
-
-            // one side with two bishops which have the same color
-            auto white_bishops = pieces(PieceType::BISHOP, Color::WHITE);
-            auto black_bishops = pieces(PieceType::BISHOP, Color::BLACK);
-
-            if (white_bishops.count() == 2) {
-                if (Square::same_color(white_bishops.lsb(), white_bishops.msb())) return true;
-            } else if (black_bishops.count() == 2) {
-                if (Square::same_color(black_bishops.lsb(), black_bishops.msb())) return true;
-            }
+        if (key == bit(Piece::WHITEBISHOP) || key == bit(Piece::BLACKBISHOP) || key == bit(Piece::WHITEKNIGHT) ||
+            key == bit(Piece::BLACKKNIGHT))
+            return true;
+
+        // two bishops, one each or both on one side, on the same color, cant mate
+        if (key == bit(Piece::WHITEBISHOP) + bit(Piece::BLACKBISHOP) || key == 2 * bit(Piece::WHITEBISHOP) ||
+            key == 2 * bit(Piece::BLACKBISHOP)) {
+            const auto bishops = pieces(PieceType::BISHOP);
+            return Square::same_color(bishops.lsb(), bishops.msb());
         }
 
         return false;
@@ -2525,11 +2690,40 @@ class Board {
         return false;
     }
 
+    /**
+     * @brief Check and pin information of a position, shared by movegen, givesCheck and SEE.
+     */
+    struct CheckInfo {
+        Bitboard checkers;   // pieces giving check to the side to move
+        Bitboard checkmask;  // squares a non-king move has to land on, all of them when not in check
+        Bitboard pin_hv;     // rays of the side to move's straight pins, pinners included
+        Bitboard pin_d;      // rays of the side to move's diagonal pins, pinners included
+        std::array<Bitboard, 2> blockers;       // [color]: lone pieces of either color between that king and an enemy slider
+        std::array<Bitboard, 2> pinners;        // [color]: enemy sliders pinning a piece of that color to its king
+        std::array<Bitboard, 6> check_squares;  // [type]: where a piece of the side to move would check the enemy king
+        U64 key    = 0ULL;
+        bool valid = false;
+    };
+
+    /**
+     * @brief The CheckInfo of the current position, computed on first use and kept for the
+     * last CHECK_INFO_CAPACITY plies. Making a move invalidates the next ply's entry only, so
+     * after unmakeMove the entry of the position returned to is still there, unless the line
+     * below it went deeper than the ring.
+     * @return
+     */
+    [[nodiscard]] const CheckInfo &checkInfo() const noexcept {
+        auto &info = check_info_[prev_states_.size() & (CHECK_INFO_CAPACITY - 1)];
+        // the key catches entries overwritten by a line longer than the ring
+        if (!info.valid || info.key != key_) computeCheckInfo(info);
+        return info;
+    }
+
     /**
      * @brief Checks if the current side to move is in check
      * @return
      */
-    [[nodiscard]] bool inCheck() const noexcept { return isAttacked(kingSq(stm_), ~stm_); }
+    [[nodiscard]] bool inCheck() const noexcept { return static_cast<bool>(checkInfo().checkers); }
 
     [[nodiscard]] CheckType givesCheck(const Move &m) const noexcept;
 
@@ -2752,11 +2946,14 @@ class Board {
 
             board.cr_.clear();
             board.prev_states_.clear();
+            board.invalidateCheckInfo();
             board.original_fen_.clear();
 
             board.occ_bb_.fill(0ULL);
             board.pieces_bb_.fill(0ULL);
             board.board_.fill(Piece::NONE);
+            board.pawn_key_     = 0ULL;
+            board.material_key_ = 0ULL;
 
             // place pieces back on the board
             while (occupied) {
@@ -2864,17 +3061,43 @@ class Board {
     };
 
    protected:
-    virtual void placePiece(Piece piece, Square sq) { placePieceInternal(piece, sq); }
+    void placePiece(Piece piece, Square sq) { placePieceInternal(piece, sq); }
+
+    void removePiece(Piece piece, Square sq) { removePieceInternal(piece, sq); }
+
+    template <typename Hooks>
+    void placePiece(Piece piece, Square sq, Hooks &hooks) {
+        placePieceInternal(piece, sq);
+        hooks.onPlacePiece(piece, sq);
+    }
+
+    template <typename Hooks>
+    void removePiece(Piece piece, Square sq, Hooks &hooks) {
+        removePieceInternal(piece, sq);
+        hooks.onRemovePiece(piece, sq);
+    }
+
+    /**
+     * @brief setFen, reporting every piece placed to hooks.
+     */
+    template <typename Hooks>
+    bool setFen(std::string_view fen, Hooks &hooks) {
+        return setFenInternal(fen, hooks);
+    }
 
-    virtual void removePiece(Piece piece, Square sq) { removePieceInternal(piece, sq); }
+    StateHistory prev_states_;
 
-    std::vector<State> prev_states_;
+    // Small, since every copy of a Board carries it. Most subtrees are shallow.
+    static constexpr std::size_t CHECK_INFO_CAPACITY = 8;  // power of two
+    mutable std::array<CheckInfo, CHECK_INFO_CAPACITY> check_info_ = {};
 
     std::array<Bitboard, 6> pieces_bb_ = {};
     std::array<Bitboard, 2> occ_bb_    = {};
     std::array<Piece, 64> board_       = {};
 
     U64 key_             = 0ULL;
+    U64 pawn_key_        = 0ULL;
+    U64 material_key_    = 0ULL;
     CastlingRights cr_   = {};
     std::uint16_t plies_ = 0;
     Color stm_           = Color::WHITE;
@@ -2886,6 +3109,11 @@ class Board {
     std::array<std::array<Bitboard, 2>, 2> castling_path = {};
 
    private:
+    void computeCheckInfo(CheckInfo &info) const noexcept;
+
+    // called whenever the position of the next ply changes
+    void invalidateCheckInfo() noexcept { check_info_[prev_states_.size() & (CHECK_INFO_CAPACITY - 1)].valid = false; }
+
     void removePieceInternal(Piece piece, Square sq) {
         assert(board_[sq.index()] == piece && piece != Piece::NONE);
 
@@ -2900,6 +3128,9 @@ class Board {
         pieces_bb_[type].clear(index);
         occ_bb_[color].clear(index);
         board_[index] = Piece::NONE;
+
+        if (type == PieceType::PAWN) pawn_key_ ^= Zobrist::piece(piece, sq);
+        material_key_ -= 1ULL << (4 * static_cast<int>(piece));
     }
 
     void placePieceInternal(Piece piece, Square sq) {
@@ -2916,10 +3147,13 @@ class Board {
         pieces_bb_[type].set(index);
         occ_bb_[color].set(index);
         board_[index] = piece;
+
+        if (type == PieceType::PAWN) pawn_key_ ^= Zobrist::piece(piece, sq);
+        material_key_ += 1ULL << (4 * static_cast<int>(piece));
     }
 
-    template <bool ctor = false>
-    bool setFenInternal(std::string_view fen) {
+    template <bool ctor = false, typename Hooks>
+    bool setFenInternal(std::string_view fen, Hooks &hooks) {
         original_fen_ = fen;
 
         reset();
@@ -2978,7 +3212,7 @@ class Board {
                 if constexpr (ctor) {
                     placePieceInternal(p, Square(square));
                 } else {
-                    placePiece(p, square);
+                    placePiece(p, square, hooks);
                 }
 
                 key_ ^= Zobrist::piece(p, Square(square));
@@ -3120,8 +3354,11 @@ class Board {
         hfm_   = 0;
         plies_ = 1;
         key_   = 0ULL;
+        pawn_key_ = 0ULL;
+        material_key_ = 0ULL;
         cr_.clear();
         prev_states_.clear();
+        invalidateCheckInfo();
     }
 
     // store the original fen string
@@ -3129,6 +3366,31 @@ class Board {
     std::string original_fen_;
 };
 
+/**
+ * @brief A Board that reports every piece its makeMove, unmakeMove and setFen place or
+ * remove to Derived, which provides onPlacePiece(Piece, Square) and onRemovePiece(Piece, Square).
+ * The calls are resolved at compile time and inline, where the plain Board's compile away.
+ * Moves made through a Board reference bypass the hooks, so they have to be undone through one too.
+ * @tparam Derived
+ */
+template <typename Derived>
+class BasicBoard : public Board {
+   public:
+    using Board::Board;
+
+    template <bool EXACT = false>
+    void makeMove(const Move move) {
+        Board::makeMove<EXACT>(move, derived());
+    }
+
+    void unmakeMove(const Move move) { Board::unmakeMove(move, derived()); }
+
+    bool setFen(std::string_view fen) { return Board::setFen(fen, derived()); }
+
+   private:
+    Derived &derived() noexcept { return static_cast<Derived &>(*this); }
+};
+
 inline std::ostream &operator<<(std::ostream &os, const Board &b) {
     for (int i = 63; i >= 0; i -= 8) {
         for (int j = 7; j >= 0; j--) {
@@ -3151,6 +3413,62 @@ inline std::ostream &operator<<(std::ostream &os, const Board &b) {
     return os;
 }
 
+inline void Board::computeCheckInfo(CheckInfo &info) const noexcept {
+    const auto occupied = occ();
+
+    for (const Color color : {Color(Color::WHITE), Color(Color::BLACK)}) {
+        const auto ksq = kingSq(color);
+
+        // enemy sliders that would see the king on an empty board, sorted by how they move
+        const auto queens   = pieces(PieceType::QUEEN, ~color);
+        const auto straight = attacks::rook(ksq, 0ULL) & (pieces(PieceType::ROOK, ~color) | queens);
+        const auto diagonal = attacks::bishop(ksq, 0ULL) & (pieces(PieceType::BISHOP, ~color) | queens);
+        const auto snipers  = straight | diagonal;
+
+        info.blockers[color] = 0ULL;
+        info.pinners[color]  = 0ULL;
+
+        // between() includes the sniper's own square
+        for (auto sniper = snipers; sniper;) {
+            const auto sq      = sniper.pop();
+            const auto blocker = movegen::between(ksq, sq) & occupied & ~Bitboard::fromSquare(sq);
+
+            if (blocker.count() == 1) {
+                info.blockers[color] |= blocker;
+                if (blocker & us(color)) info.pinners[color] |= Bitboard::fromSquare(sq);
+            }
+        }
+
+        if (color != stm_) continue;
+
+        info.pin_hv = 0ULL;
+        info.pin_d  = 0ULL;
+
+        for (auto pinner = info.pinners[color]; pinner;) {
+            const auto sq = pinner.pop();
+            (straight.check(sq) ? info.pin_hv : info.pin_d) |= movegen::between(ksq, sq);
+        }
+    }
+
+    const auto ksq = kingSq(stm_);
+
+    info.checkers  = attacks::attackers(*this, ~stm_, ksq);
+    info.checkmask = info.checkers.count() == 1 ? movegen::between(ksq, Square(info.checkers.lsb()))
+                                                : info.checkers ? Bitboard(0ULL) : constants::DEFAULT_CHECKMASK;
+
+    const auto enemy_ksq = kingSq(~stm_);
+
+    const auto bishop_checks = attacks::bishop(enemy_ksq, occupied);
+    const auto rook_checks   = attacks::rook(enemy_ksq, occupied);
+
+    // indexed pawn to king
+    info.check_squares = {attacks::pawn(~stm_, enemy_ksq), attacks::knight(enemy_ksq), bishop_checks, rook_checks,
+                          bishop_checks | rook_checks, 0ULL};
+
+    info.key   = key_;
+    info.valid = true;
+}
+
 inline CheckType Board::givesCheck(const Move &m) const noexcept {
     const static auto getSniper = [](const Board *board, Square ksq, Bitboard oc) {
         const auto us_occ = board->us(board->sideToMove());
@@ -3161,38 +3479,22 @@ inline CheckType Board::givesCheck(const Move &m) const noexcept {
 
     assert(at(m.from()).color() == stm_);
 
+    const auto &info    = checkInfo();
     const Square from   = m.from();
     const Square to     = m.to();
     const Square ksq    = kingSq(~stm_);
     const Bitboard toBB = Bitboard::fromSquare(to);
     const PieceType pt  = at(from).type();
 
-    Bitboard fromKing = 0ull;
+    if (info.check_squares[pt] & toBB) return CheckType::DIRECT_CHECK;
 
-    if (pt == PieceType::PAWN) {
-        fromKing = attacks::pawn(~stm_, ksq);
-    } else if (pt == PieceType::KNIGHT) {
-        fromKing = attacks::knight(ksq);
-    } else if (pt == PieceType::BISHOP) {
-        fromKing = attacks::bishop(ksq, occ());
-    } else if (pt == PieceType::ROOK) {
-        fromKing = attacks::rook(ksq, occ());
-    } else if (pt == PieceType::QUEEN) {
-        fromKing = attacks::queen(ksq, occ());
-    }
-
-    if (fromKing & toBB) return CheckType::DIRECT_CHECK;
-
-    // Discovery check
+    // Discovery check, unless the blocker stays on the line between the king and our slider
     const Bitboard fromBB = Bitboard::fromSquare(from);
     const Bitboard oc     = occ() ^ fromBB;
 
-    Bitboard sniper = getSniper(this, ksq, oc);
-
-    while (sniper) {
-        Square sq = sniper.pop();
-        return (!(movegen::between(ksq, sq) & toBB) || m.typeOf() == Move::CASTLING) ? CheckType::DISCOVERY_CHECK
-                                                                                     : CheckType::NO_CHECK;
+    if (info.blockers[~stm_] & fromBB) {
+        const bool aligned = (movegen::between(ksq, from) & toBB) || (movegen::between(ksq, to) & fromBB);
+        if (!aligned || m.typeOf() == Move::CASTLING) return CheckType::DISCOVERY_CHECK;
     }
 
     switch (m.typeOf()) {
@@ -3512,9 +3814,35 @@ template <Color::underlying c>
     return seen;
 }
 
+template <Color::underlying c>
+[[nodiscard]] inline Bitboard movegen::safeKingSquares(const Board &board, Square sq, Bitboard movable_square) {
+    // the king doesn't block a slider's ray behind it
+    const auto occ     = board.occ() ^ Bitboard::fromSquare(sq);
+    const auto queens  = board.pieces(PieceType::QUEEN, ~c);
+    const auto bishops = board.pieces(PieceType::BISHOP, ~c) | queens;
+    const auto rooks   = board.pieces(PieceType::ROOK, ~c) | queens;
+
+    Bitboard safe    = 0ull;
+    Bitboard targets = attacks::king(sq) & movable_square;
+
+    while (targets) {
+        const Square to = targets.pop();
+
+        if (attacks::pawn(c, to) & board.pieces(PieceType::PAWN, ~c)) continue;
+        if (attacks::knight(to) & board.pieces(PieceType::KNIGHT, ~c)) continue;
+        if (attacks::king(to) & board.pieces(PieceType::KING, ~c)) continue;
+        if (attacks::bishop(to, occ) & bishops) continue;
+        if (attacks::rook(to, occ) & rooks) continue;
+
+        safe.set(to.index());
+    }
+
+    return safe;
+}
+
 template <Color::underlying c, movegen::MoveGenType mt>
 inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitboard pin_d, Bitboard pin_hv,
-                                       Bitboard checkmask, Bitboard occ_opp) {
+                                       Bitboard checkmask, Bitboard occ_opp, Bitboard targets) {
     // flipped for black
 
     constexpr auto UP         = make_direction(Direction::NORTH, c);
@@ -3539,8 +3867,8 @@ inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitb
     auto r_pawns = attacks::shift<UP_RIGHT>(unpinned_pawns_lr) | (attacks::shift<UP_RIGHT>(pinned_pawns_lr) & pin_d);
 
     // Prune moves that don't capture a piece and are not on the checkmask.
-    l_pawns &= occ_opp & checkmask;
-    r_pawns &= occ_opp & checkmask;
+    l_pawns &= occ_opp & checkmask & targets;
+    r_pawns &= occ_opp & checkmask & targets;
 
     // These pawns can walk Forward
     const auto pawns_hv = pawns & ~pin_d;
@@ -3553,11 +3881,11 @@ inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitb
     const auto single_push_pinned   = attacks::shift<UP>(pawns_pinned_hv) & pin_hv & ~board.occ();
 
     // Prune moves that are not on the checkmask.
-    Bitboard single_push = (single_push_unpinned | single_push_pinned) & checkmask;
+    Bitboard single_push = (single_push_unpinned | single_push_pinned) & checkmask & targets;
 
     Bitboard double_push = ((attacks::shift<UP>(single_push_unpinned & DOUBLE_PUSH_RANK) & ~board.occ()) |
                             (attacks::shift<UP>(single_push_pinned & DOUBLE_PUSH_RANK) & ~board.occ())) &
-                           checkmask;
+                           checkmask & targets;
 
     if (pawns & RANK_B_PROMO) {
         Bitboard promo_left  = l_pawns & RANK_PROMO;
@@ -3623,7 +3951,9 @@ inline void movegen::generatePawnMoves(const Board &board, Movelist &moves, Bitb
 
     const Square ep = board.enpassantSq();
 
-    if (ep != Square::NO_SQ) {
+    // the target test is separate from the checkmask one, in check from the pawn that just
+    // moved the en passant square is a target but not on the checkmask
+    if (ep != Square::NO_SQ && (targets & (Bitboard::fromSquare(ep) | Bitboard::fromSquare(ep + DOWN)))) {
         auto m = generateEPMove(board, checkmask, pin_d, pawns_lr, ep, c);
 
         for (const auto &move : m) {
@@ -3765,7 +4095,7 @@ inline void movegen::whileBitboardAdd(Movelist &movelist, Bitboard mask, T func)
 }
 
 template <Color::underlying c, movegen::MoveGenType mt>
-inline void movegen::legalmoves(Movelist &movelist, const Board &board, int pieces) {
+inline void movegen::legalmoves(Movelist &movelist, const Board &board, int pieces, Bitboard targets) {
     /*
      The size of the movelist might not
      be 0! This is done on purpose since it enables
@@ -3779,29 +4109,39 @@ inline void movegen::legalmoves(Movelist &movelist, const Board &board, int piec
 
     Bitboard opp_empty = ~occ_us;
 
-    const auto [checkmask, checks] = checkMask<c>(board, king_sq);
-    const auto pin_hv              = pinMask<c, PieceType::ROOK>(board, king_sq, occ_opp, occ_us);
-    const auto pin_d               = pinMask<c, PieceType::BISHOP>(board, king_sq, occ_opp, occ_us);
+    const auto &info     = board.checkInfo();
+    const auto checkmask = info.checkmask;
+    const auto pin_hv    = info.pin_hv;
+    const auto pin_d     = info.pin_d;
+    const auto checks    = std::min(info.checkers.count(), 2);
 
-    assert(checks <= 2);
+    assert(mt != MoveGenType::EVASIONS || checks > 0);
 
     Bitboard movable_square;
 
     // Slider, Knights and King moves can only go to enemy or empty squares.
-    if constexpr (mt == MoveGenType::ALL)
+    if constexpr (mt == MoveGenType::ALL || mt == MoveGenType::EVASIONS)
         movable_square = opp_empty;
     else if constexpr (mt == MoveGenType::CAPTURE)
         movable_square = occ_opp;
     else  // QUIET moves
         movable_square = ~occ_all;
 
-    if (pieces & PieceGenType::KING) {
-        Bitboard seen = seenSquares<~c>(board, opp_empty);
+    movable_square &= targets;
+
+    if (mt == MoveGenType::EVASIONS && (pieces & PieceGenType::KING)) {
+        auto moves_bb = safeKingSquares<c>(board, king_sq, movable_square);
+
+        while (moves_bb) {
+            movelist.add(Move::make<Move::NORMAL>(king_sq, moves_bb.pop()));
+        }
+    } else if (pieces & PieceGenType::KING) {
+        Bitboard seen = seenSquares<~c>(board, opp_empty & targets);
 
         whileBitboardAdd(movelist, Bitboard::fromSquare(king_sq),
                          [&](Square sq) { return generateKingMoves(sq, seen, movable_square); });
 
-        if (mt != MoveGenType::CAPTURE && checks == 0) {
+        if (mt != MoveGenType::CAPTURE && mt != MoveGenType::EVASIONS && checks == 0 && targets == ~Bitboard(0ULL)) {
             Bitboard moves_bb = generateCastleMoves<c>(board, king_sq, seen, pin_hv);
 
             while (moves_bb) {
@@ -3817,21 +4157,37 @@ inline void movegen::legalmoves(Movelist &movelist, const Board &board, int piec
     // Moves have to be on the checkmask
     movable_square &= checkmask;
 
+    // Only pieces that can land on the checkmask need generating.
+    Bitboard movers    = ~Bitboard(0ULL);
+    bool pawn_evasions = true;
+
+    if constexpr (mt == MoveGenType::EVASIONS) {
+        // A pinned piece can't leave its pin ray, which only meets the checking line at the king.
+        movers = ~(pin_d | pin_hv);
+
+        // A checker next to the king or a knight can only be captured.
+        if (checkmask == info.checkers) {
+            const auto checker_sq = Square(info.checkers.lsb());
+            movers &= attacks::attackers(board, c, checker_sq);
+            pawn_evasions = static_cast<bool>(movers & board.pieces(PieceType::PAWN, c)) || board.enpassantSq() != Square::NO_SQ;
+        }
+    }
+
     // Add the moves to the movelist.
-    if (pieces & PieceGenType::PAWN) {
-        generatePawnMoves<c, mt>(board, movelist, pin_d, pin_hv, checkmask, occ_opp);
+    if ((pieces & PieceGenType::PAWN) && pawn_evasions) {
+        generatePawnMoves<c, mt>(board, movelist, pin_d, pin_hv, checkmask, occ_opp, targets);
     }
 
     if (pieces & PieceGenType::KNIGHT) {
         // Prune knights that are pinned since these cannot move.
-        Bitboard knights_mask = board.pieces(PieceType::KNIGHT, c) & ~(pin_d | pin_hv);
+        Bitboard knights_mask = board.pieces(PieceType::KNIGHT, c) & ~(pin_d | pin_hv) & movers;
 
         whileBitboardAdd(movelist, knights_mask, [&](Square sq) { return generateKnightMoves(sq) & movable_square; });
     }
 
     if (pieces & PieceGenType::BISHOP) {
         // Prune horizontally pinned bishops
-        Bitboard bishops_mask = board.pieces(PieceType::BISHOP, c) & ~pin_hv;
+        Bitboard bishops_mask = board.pieces(PieceType::BISHOP, c) & ~pin_hv & movers;
 
         whileBitboardAdd(movelist, bishops_mask,
                          [&](Square sq) { return generateBishopMoves(sq, pin_d, occ_all) & movable_square; });
@@ -3839,7 +4195,7 @@ inline void movegen::legalmoves(Movelist &movelist, const Board &board, int piec
 
     if (pieces & PieceGenType::ROOK) {
         //  Prune diagonally pinned rooks
-        Bitboard rooks_mask = board.pieces(PieceType::ROOK, c) & ~pin_d;
+        Bitboard rooks_mask = board.pieces(PieceType::ROOK, c) & ~pin_d & movers;
 
         whileBitboardAdd(movelist, rooks_mask,
                          [&](Square sq) { return generateRookMoves(sq, pin_hv, occ_all) & movable_square; });
@@ -3847,7 +4203,7 @@ inline void movegen::legalmoves(Movelist &movelist, const Board &board, int piec
 
     if (pieces & PieceGenType::QUEEN) {
         // Prune double pinned queens
-        Bitboard queens_mask = board.pieces(PieceType::QUEEN, c) & ~(pin_d & pin_hv);
+        Bitboard queens_mask = board.pieces(PieceType::QUEEN, c) & ~(pin_d & pin_hv) & movers;
 
         whileBitboardAdd(movelist, queens_mask,
                          [&](Square sq) { return generateQueenMoves(sq, pin_d, pin_hv, occ_all) & movable_square; });
@@ -3859,9 +4215,99 @@ inline void movegen::legalmoves(Movelist &movelist, const Board &board, int piec
     movelist.clear();
 
     if (board.sideToMove() == Color::WHITE)
-        legalmoves<Color::WHITE, mt>(movelist, board, pieces);
+        legalmoves<Color::WHITE, mt>(movelist, board, pieces, ~Bitboard(0ULL));
+    else
+        legalmoves<Color::BLACK, mt>(movelist, board, pieces, ~Bitboard(0ULL));
+}
+
+template <movegen::MoveGenType mt>
+inline void movegen::targetmoves(Movelist &movelist, const Board &board, Bitboard targets, int pieces) {
+    movelist.clear();
+
+    if (board.sideToMove() == Color::WHITE)
+        legalmoves<Color::WHITE, mt>(movelist, board, pieces, targets);
+    else
+        legalmoves<Color::BLACK, mt>(movelist, board, pieces, targets);
+}
+
+template <Color::underlying c>
+inline void movegen::quietchecks(Movelist &movelist, const Board &board) {
+    constexpr auto UP               = make_direction(Direction::NORTH, c);
+    constexpr auto RANK_B_PROMO     = Rank::rank(Rank::RANK_7, c).bb();
+    constexpr auto DOUBLE_PUSH_RANK = Rank::rank(Rank::RANK_3, c).bb();
+
+    const auto &info = board.checkInfo();
+
+    assert(!info.checkers);
+
+    const auto occ_all   = board.occ();
+    const auto empty     = ~occ_all;
+    const auto pin_hv    = info.pin_hv;
+    const auto pin_d     = info.pin_d;
+    const auto enemy_ksq = board.kingSq(~c);
+
+    // our pieces between the enemy king and one of our sliders
+    const auto discoverers = info.blockers[Color(~c)] & board.us(c);
+
+    // Empty squares a piece of type pt on sq checks from: the check squares, and for a
+    // discoverer also every square off the line between our slider and the enemy king.
+    const auto checkingSquares = [&](Square sq, PieceType pt) {
+        auto squares = info.check_squares[pt];
+
+        if (discoverers.check(sq.index())) {
+            const auto occ     = occ_all ^ Bitboard::fromSquare(sq);
+            const auto queens  = board.pieces(PieceType::QUEEN, c);
+            const auto sniper  = (attacks::bishop(enemy_ksq, occ) & (board.pieces(PieceType::BISHOP, c) | queens)) |
+                                 (attacks::rook(enemy_ksq, occ) & (board.pieces(PieceType::ROOK, c) | queens));
+            squares |= ~between(enemy_ksq, Square(sniper.lsb()));
+        }
+
+        return squares & empty;
+    };
+
+    // Pawns only ever move along their file, so the push target is all there is to check.
+    const auto pawns = board.pieces(PieceType::PAWN, c) & ~RANK_B_PROMO & ~pin_d;
+
+    whileBitboardAdd(movelist, pawns, [&](Square sq) {
+        auto pushes = attacks::shift<UP>(Bitboard::fromSquare(sq)) & empty;
+        pushes |= attacks::shift<UP>(pushes & DOUBLE_PUSH_RANK) & empty;
+        if (pin_hv.check(sq.index())) pushes &= pin_hv;
+        return pushes & checkingSquares(sq, PieceType::PAWN);
+    });
+
+    const auto knights = board.pieces(PieceType::KNIGHT, c) & ~(pin_d | pin_hv);
+    const auto bishops = board.pieces(PieceType::BISHOP, c) & ~pin_hv;
+    const auto rooks   = board.pieces(PieceType::ROOK, c) & ~pin_d;
+    const auto queens  = board.pieces(PieceType::QUEEN, c) & ~(pin_d & pin_hv);
+
+    whileBitboardAdd(movelist, knights,
+                     [&](Square sq) { return generateKnightMoves(sq) & checkingSquares(sq, PieceType::KNIGHT); });
+    whileBitboardAdd(movelist, bishops, [&](Square sq) {
+        return generateBishopMoves(sq, pin_d, occ_all) & checkingSquares(sq, PieceType::BISHOP);
+    });
+    whileBitboardAdd(movelist, rooks, [&](Square sq) {
+        return generateRookMoves(sq, pin_hv, occ_all) & checkingSquares(sq, PieceType::ROOK);
+    });
+    whileBitboardAdd(movelist, queens, [&](Square sq) {
+        return generateQueenMoves(sq, pin_d, pin_hv, occ_all) & checkingSquares(sq, PieceType::QUEEN);
+    });
+
+    // the king never checks directly, but may step out of the way of one of our sliders
+    const auto king_sq = board.kingSq(c);
+    if (discoverers.check(king_sq.index())) {
+        whileBitboardAdd(movelist, Bitboard::fromSquare(king_sq), [&](Square sq) {
+            return safeKingSquares<c>(board, sq, checkingSquares(sq, PieceType::KING));
+        });
+    }
+}
+
+inline void movegen::quietchecks(Movelist &movelist, const Board &board) {
+    movelist.clear();
+
+    if (board.sideToMove() == Color::WHITE)
+        quietchecks<Color::WHITE>(movelist, board);
     else
-        legalmoves<Color::BLACK, mt>(movelist, board, pieces);
+        quietchecks<Color::BLACK>(movelist, board);
 }
 
 template <Color::underlying c>
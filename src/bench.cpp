@@ -0,0 +1,200 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+
+#include "thread.hpp"
+#include "tt.hpp"
+#include "types.hpp"
+
+using namespace chess;
+
+namespace
+{
+    constexpr std::array<const char *, 8> BENCH_FENS = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N2N2/PP2BPPP/R2QKB1R w KQ - 0 1",
+        "r2q1rk1/pp2ppbp/2p2np1/6B1/3PP1b1/Q1P2N2/P4PPP/3RKB1R b K - 0 13",
+        "2r3k1/1q1nbppp/r3p3/3pP3/pPpP4/P1Q2N2/2RN1PPP/2R4K b - - 0 23",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "6k1/5p2/6p1/8/7p/8/6PP/6K1 b - - 0 1",
+        "8/8/1p4k1/p1p1pr2/P1P1R3/1P3K2/8/8 w - - 0 40",
+    };
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    int64_t msSince(Clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+    }
+
+    uint64_t perftUnmake(Board &board, int depth)
+    {
+        Movelist moves;
+        movegen::legalmoves(moves, board);
+        if (depth == 1)
+        {
+            return moves.size();
+        }
+
+        uint64_t nodes = 0;
+        for (const auto &move : moves)
+        {
+            board.makeMove(move);
+            nodes += perftUnmake(board, depth - 1);
+            board.unmakeMove(move);
+        }
+        return nodes;
+    }
+
+    uint64_t perftCopy(Board &board, int depth, Board::Position *positions)
+    {
+        Movelist moves;
+        movegen::legalmoves(moves, board);
+        if (depth == 1)
+        {
+            return moves.size();
+        }
+
+        uint64_t nodes = 0;
+        board.savePosition(*positions);
+        for (const auto &move : moves)
+        {
+            board.makeMove(move);
+            nodes += perftCopy(board, depth - 1, positions + 1);
+            board.restorePosition(*positions);
+        }
+        return nodes;
+    }
+
+    // Time spent generating the moves of every position in check below board, per MoveGenType.
+    struct EvasionTimes
+    {
+        uint64_t positions = 0;
+        uint64_t moves = 0;
+        std::array<int64_t, 3> ns = {}; // all, captures then quiets, evasions
+    };
+
+    constexpr int EVASION_REPEATS = 64;
+
+    template <typename Generate>
+    int64_t timeGeneration(Generate generate)
+    {
+        const auto start = Clock::now();
+        for (int i = 0; i < EVASION_REPEATS; ++i)
+        {
+            generate();
+        }
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    void collectEvasionTimes(Board &board, int depth, EvasionTimes &times)
+    {
+        Movelist moves;
+        if (board.inCheck())
+        {
+            Movelist all, captures, quiets, evasions;
+            times.ns[0] += timeGeneration([&] { movegen::legalmoves(all, board); });
+            times.ns[1] += timeGeneration([&] {
+                movegen::legalmoves<movegen::MoveGenType::CAPTURE>(captures, board);
+                movegen::legalmoves<movegen::MoveGenType::QUIET>(quiets, board);
+            });
+            times.ns[2] += timeGeneration([&] { movegen::legalmoves<movegen::MoveGenType::EVASIONS>(evasions, board); });
+
+            // all three have to agree on the moves
+            if (evasions.size() != all.size() || captures.size() + quiets.size() != all.size())
+            {
+                std::cout << "info string evasion mismatch " << board.getFen() << std::endl;
+            }
+            times.positions++;
+            times.moves += evasions.size();
+        }
+
+        if (depth == 0)
+        {
+            return;
+        }
+
+        movegen::legalmoves(moves, board);
+        for (const auto &move : moves)
+        {
+            board.makeMove(move);
+            collectEvasionTimes(board, depth - 1, times);
+            board.unmakeMove(move);
+        }
+    }
+
+    void printResult(const char *name, uint64_t nodes, int64_t ms)
+    {
+        std::lock_guard<std::mutex> lock(io_mutex);
+        std::cout << "info string " << name << " nodes " << nodes << " time " << ms << " nps "
+                  << nodes * 1000 / std::max<int64_t>(ms, 1) << std::endl;
+    }
+}
+
+void perft(const Board &board, int depth)
+{
+    depth = std::clamp(depth, 1, MAX_PLY);
+
+    auto copy = board;
+    auto start = Clock::now();
+    const auto unmake_nodes = perftUnmake(copy, depth);
+    printResult("perft make/unmake", unmake_nodes, msSince(start));
+
+    std::array<Board::Position, MAX_PLY> positions;
+    start = Clock::now();
+    const auto copy_nodes = perftCopy(copy, depth, positions.data());
+    printResult("perft copy-make", copy_nodes, msSince(start));
+}
+
+void bench(int depth)
+{
+    const bool copy_make = threads.copy_make;
+
+    for (const bool mode : {false, true})
+    {
+        threads.copy_make = mode;
+        transposition_table.clear(threads.size());
+        threads.clear();
+
+        uint64_t nodes = 0;
+        const auto start = Clock::now();
+        for (const auto *fen : BENCH_FENS)
+        {
+            SearchLimits limits;
+            limits.start = Clock::now();
+            limits.depth = depth;
+
+            transposition_table.newSearch();
+            threads.startSearch(Board(fen), limits);
+            threads.main().waitForSearchFinished();
+            nodes += threads.nodesSearched();
+        }
+        printResult(mode ? "bench copy-make" : "bench make/unmake", nodes, msSince(start));
+    }
+
+    threads.copy_make = copy_make;
+}
+
+void benchEvasions()
+{
+    EvasionTimes times;
+    for (const auto *fen : BENCH_FENS)
+    {
+        Board board(fen);
+        collectEvasionTimes(board, EVASION_DEPTH, times);
+    }
+
+    std::lock_guard<std::mutex> lock(io_mutex);
+    std::cout << "info string evasions positions " << times.positions << " moves " << times.moves << std::endl;
+    constexpr std::array<const char *, 3> NAMES = {"all", "captures+quiets", "evasions"};
+    for (size_t i = 0; i < NAMES.size(); ++i)
+    {
+        std::cout << "info string evasions " << NAMES[i] << " ns/position "
+                  << times.ns[i] / std::max<int64_t>(times.positions * EVASION_REPEATS, 1) << std::endl;
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include "chess.hpp"
+
+constexpr int BENCH_DEPTH = 8;
+
+// Counts the leaves of the legal move tree below board to depth, once undoing moves with
+// unmakeMove and once by restoring a copy, and prints both counts and speeds.
+void perft(const chess::Board &board, int depth);
+
+// Searches a fixed set of positions to depth with either way of undoing moves, on a fresh
+// hash table each time, and prints the totals. Both runs search the same tree.
+void bench(int depth);
+
+constexpr int EVASION_DEPTH = 4;
+
+// Generates the moves of every position in check within EVASION_DEPTH plies of the bench
+// positions as ALL, as CAPTURE then QUIET, and as EVASIONS, and prints the time each takes.
+void benchEvasions();
+
+#endif
@@ -0,0 +1,407 @@
+#include "evaluate.hpp"
+
+#include <algorithm>
+#include <array>
+
+#include "types.hpp"
+
+using namespace chess;
+
+namespace
+{
+    // PeSTO material and piece-square tables, indexed by PieceType.
+    constexpr std::array<int, 6> MG_VALUE = {82, 337, 365, 477, 1025, 0};
+    constexpr std::array<int, 6> EG_VALUE = {94, 281, 297, 512, 936, 0};
+
+    // From white's point of view, a8 first so that the tables read like a diagram.
+    using Table = std::array<int, 64>;
+
+    constexpr std::array<Table, 6> MG_TABLE = {{
+        // pawn
+        {0, 0, 0, 0, 0, 0, 0, 0,
+         98, 134, 61, 95, 68, 126, 34, -11,
+         -6, 7, 26, 31, 65, 56, 25, -20,
+         -14, 13, 6, 21, 23, 12, 17, -23,
+         -27, -2, -5, 12, 17, 6, 10, -25,
+         -26, -4, -4, -10, 3, 3, 33, -12,
+         -35, -1, -20, -23, -15, 24, 38, -22,
+         0, 0, 0, 0, 0, 0, 0, 0},
+        // knight
+        {-167, -89, -34, -49, 61, -97, -15, -107,
+         -73, -41, 72, 36, 23, 62, 7, -17,
+         -47, 60, 37, 65, 84, 129, 73, 44,
+         -9, 17, 19, 53, 37, 69, 18, 22,
+         -13, 4, 16, 13, 28, 19, 21, -8,
+         -23, -9, 12, 10, 19, 17, 25, -16,
+         -29, -53, -12, -3, -1, 18, -14, -19,
+         -105, -21, -58, -33, -17, -28, -19, -23},
+        // bishop
+        {-29, 4, -82, -37, -25, -42, 7, -8,
+         -26, 16, -18, -13, 30, 59, 18, -47,
+         -16, 37, 43, 40, 35, 50, 37, -2,
+         -4, 5, 19, 50, 37, 37, 7, -2,
+         -6, 13, 13, 26, 34, 12, 10, 4,
+         0, 15, 15, 15, 14, 27, 18, 10,
+         4, 15, 16, 0, 7, 21, 33, 1,
+         -33, -3, -14, -21, -13, -12, -39, -21},
+        // rook
+        {32, 42, 32, 51, 63, 9, 31, 43,
+         27, 32, 58, 62, 80, 67, 26, 44,
+         -5, 19, 26, 36, 17, 45, 61, 16,
+         -24, -11, 7, 26, 24, 35, -8, -20,
+         -36, -26, -12, -1, 9, -7, 6, -23,
+         -45, -25, -16, -17, 3, 0, -5, -33,
+         -44, -16, -20, -9, -1, 11, -6, -71,
+         -19, -13, 1, 17, 16, 7, -37, -26},
+        // queen
+        {-28, 0, 29, 12, 59, 44, 43, 45,
+         -24, -39, -5, 1, -16, 57, 28, 54,
+         -13, -17, 7, 8, 29, 56, 47, 57,
+         -27, -27, -16, -16, -1, 17, -2, 1,
+         -9, -26, -9, -10, -2, -4, 3, -3,
+         -14, 2, -11, -2, -5, 2, 14, 5,
+         -35, -8, 11, 2, 8, 15, -3, 1,
+         -1, -18, -9, 10, -15, -25, -31, -50},
+        // king
+        {-65, 23, 16, -15, -56, -34, 2, 13,
+         29, -1, -20, -7, -8, -4, -38, -29,
+         -9, 24, 2, -16, -20, 6, 22, -22,
+         -17, -20, -12, -27, -30, -25, -14, -36,
+         -49, -1, -27, -39, -46, -44, -33, -51,
+         -14, -14, -22, -46, -44, -30, -15, -27,
+         1, 7, -8, -64, -43, -16, 9, 8,
+         -15, 36, 12, -54, 8, -28, 24, 14},
+    }};
+
+    constexpr std::array<Table, 6> EG_TABLE = {{
+        // pawn
+        {0, 0, 0, 0, 0, 0, 0, 0,
+         178, 173, 158, 134, 147, 132, 165, 187,
+         94, 100, 85, 67, 56, 53, 82, 84,
+         32, 24, 13, 5, -2, 4, 17, 17,
+         13, 9, -3, -7, -7, -8, 3, -1,
+         4, 7, -6, 1, 0, -5, -1, -8,
+         13, 8, 8, 10, 13, 0, 2, -7,
+         0, 0, 0, 0, 0, 0, 0, 0},
+        // knight
+        {-58, -38, -13, -28, -31, -27, -63, -99,
+         -25, -8, -25, -2, -9, -25, -24, -52,
+         -24, -20, 10, 9, -1, -9, -19, -41,
+         -17, 3, 22, 22, 22, 11, 8, -18,
+         -18, -6, 16, 25, 16, 17, 4, -18,
+         -23, -3, -1, 15, 10, -3, -20, -22,
+         -42, -20, -10, -5, -2, -20, -23, -44,
+         -29, -51, -23, -15, -22, -18, -50, -64},
+        // bishop
+        {-14, -21, -11, -8, -7, -9, -17, -24,
+         -8, -4, 7, -12, -3, -13, -4, -14,
+         2, -8, 0, -1, -2, 6, 0, 4,
+         -3, 9, 12, 9, 14, 10, 3, 2,
+         -6, 3, 13, 19, 7, 10, -3, -9,
+         -12, -3, 8, 10, 13, 3, -7, -15,
+         -14, -18, -7, -1, 4, -9, -15, -27,
+         -23, -9, -23, -5, -9, -16, -5, -17},
+        // rook
+        {13, 10, 18, 15, 12, 12, 8, 5,
+         11, 13, 13, 11, -3, 3, 8, 3,
+         7, 7, 7, 5, 4, -3, -5, -3,
+         4, 3, 13, 1, 2, 1, -1, 2,
+         3, 5, 8, 4, -5, -6, -8, -11,
+         -4, 0, -5, -1, -7, -12, -8, -16,
+         -6, -6, 0, 2, -9, -9, -11, -3,
+         -9, 2, 3, -1, -5, -13, 4, -20},
+        // queen
+        {-9, 22, 22, 27, 27, 19, 10, 20,
+         -17, 20, 32, 41, 58, 25, 30, 0,
+         -20, 6, 9, 49, 47, 35, 19, 9,
+         3, 22, 24, 45, 57, 40, 57, 36,
+         -18, 28, 19, 47, 31, 34, 39, 23,
+         -16, -27, 15, 6, 9, 17, 10, 5,
+         -22, -23, -30, -16, -16, -23, -36, -32,
+         -33, -28, -22, -43, -5, -32, -20, -41},
+        // king
+        {-74, -35, -18, -18, -11, 15, 4, -17,
+         -12, 17, 14, 17, 17, 38, 23, 11,
+         10, 17, 23, 15, 20, 45, 44, 13,
+         -8, 22, 24, 27, 26, 33, 26, 3,
+         -18, -4, 21, 24, 27, 23, 9, -11,
+         -19, -3, 11, 21, 23, 16, 7, -9,
+         -27, -11, 4, 13, 14, 4, -5, -17,
+         -53, -34, -21, -11, -28, -14, -24, -43},
+    }};
+
+    struct PsqtEntry
+    {
+        int mg;
+        int eg;
+    };
+
+    // [Piece][square]: material plus the square bonus, negated for black.
+    constexpr auto PSQT = []
+    {
+        std::array<std::array<PsqtEntry, 64>, 12> table{};
+        for (int type = 0; type < 6; ++type)
+        {
+            for (int sq = 0; sq < 64; ++sq)
+            {
+                // the tables start at a8, square indices at a1
+                table[type][sq] = {MG_VALUE[type] + MG_TABLE[type][sq ^ 56], EG_VALUE[type] + EG_TABLE[type][sq ^ 56]};
+                table[type + 6][sq] = {-(MG_VALUE[type] + MG_TABLE[type][sq]), -(EG_VALUE[type] + EG_TABLE[type][sq])};
+            }
+        }
+        return table;
+    }();
+
+    // Bonus per square a piece can move to, indexed by PieceType. Pawns and kings don't count.
+    constexpr std::array<int, 6> MOBILITY_MG = {0, 4, 5, 2, 1, 0};
+    constexpr std::array<int, 6> MOBILITY_EG = {0, 4, 5, 4, 2, 0};
+
+    // Adds the weighted mobility of color's knights, bishops, rooks and queens. Squares held
+    // by its own pieces or guarded by an enemy pawn are not worth going to, so they don't count.
+    template <Color::underlying color>
+    void addMobility(const Board &board, int &mg, int &eg)
+    {
+        constexpr auto them = color == Color::WHITE ? Color::BLACK : Color::WHITE;
+        constexpr int sign = color == Color::WHITE ? 1 : -1;
+
+        const auto occupied = board.occ();
+        const auto enemy_pawns = board.pieces(PieceType::PAWN, them);
+        const auto guarded = attacks::pawnLeftAttacks<them>(enemy_pawns) | attacks::pawnRightAttacks<them>(enemy_pawns);
+        const auto targets = ~board.us(color) & ~guarded;
+
+        for (const PieceType type : {PieceType::KNIGHT, PieceType::BISHOP, PieceType::ROOK, PieceType::QUEEN})
+        {
+            auto pieces = board.pieces(type, color);
+            while (pieces)
+            {
+                const auto sq = Square(pieces.pop());
+
+                Bitboard reach;
+                switch (type.internal())
+                {
+                case PieceType::KNIGHT:
+                    reach = attacks::knight(sq);
+                    break;
+                case PieceType::BISHOP:
+                    reach = attacks::bishop(sq, occupied);
+                    break;
+                case PieceType::ROOK:
+                    reach = attacks::rook(sq, occupied);
+                    break;
+                default:
+                    reach = attacks::queen(sq, occupied);
+                    break;
+                }
+
+                const int count = (reach & targets).count();
+                mg += sign * MOBILITY_MG[type] * count;
+                eg += sign * MOBILITY_EG[type] * count;
+            }
+        }
+    }
+}
+
+EvalBoard::EvalBoard(std::string_view fen) : BasicBoard(fen)
+{
+    // the Board constructor places its pieces without going through the hooks
+    refresh();
+}
+
+EvalBoard &EvalBoard::operator=(const Board &board)
+{
+    Board::operator=(board);
+    refresh();
+    return *this;
+}
+
+bool EvalBoard::setFen(std::string_view fen)
+{
+    mg_ = eg_ = 0;
+    return BasicBoard::setFen(fen);
+}
+
+void EvalBoard::save(Snapshot &snapshot) const
+{
+    savePosition(snapshot.position);
+    snapshot.mg = mg_;
+    snapshot.eg = eg_;
+    if (network.loaded())
+    {
+        snapshot.accumulator = accumulator_;
+    }
+}
+
+void EvalBoard::restore(const Snapshot &snapshot)
+{
+    restorePosition(snapshot.position);
+    mg_ = snapshot.mg;
+    eg_ = snapshot.eg;
+    if (network.loaded())
+    {
+        accumulator_ = snapshot.accumulator;
+    }
+}
+
+void EvalBoard::account(Piece piece, Square sq, int sign)
+{
+    const auto &entry = PSQT[piece][sq.index()];
+    mg_ += sign * entry.mg;
+    eg_ += sign * entry.eg;
+
+    if (!network.loaded())
+    {
+        return;
+    }
+
+    for (const Color perspective : {Color::WHITE, Color::BLACK})
+    {
+        if (piece.type() == PieceType::KING && piece.color() == perspective)
+        {
+            // every feature of this half depends on the king square, start over once it lands
+            if (sign > 0)
+            {
+                network.refresh(accumulator_, *this, perspective);
+            }
+            continue;
+        }
+
+        // the king is in the middle of a move or a setFen, and the refresh on its arrival covers sq
+        const auto king = pieces(PieceType::KING, perspective);
+        if (!king)
+        {
+            continue;
+        }
+
+        if (sign > 0)
+        {
+            network.addPiece(accumulator_, perspective, king.lsb(), piece, sq);
+        }
+        else
+        {
+            network.removePiece(accumulator_, perspective, king.lsb(), piece, sq);
+        }
+    }
+}
+
+void EvalBoard::refresh()
+{
+    mg_ = eg_ = 0;
+    auto occupied = occ();
+    while (occupied)
+    {
+        const auto sq = Square(occupied.pop());
+        const auto &entry = PSQT[at(sq)][sq.index()];
+        mg_ += entry.mg;
+        eg_ += entry.eg;
+    }
+
+    if (network.loaded())
+    {
+        network.refresh(accumulator_, *this, Color::WHITE);
+        network.refresh(accumulator_, *this, Color::BLACK);
+    }
+}
+
+bool EvalCache::probe(uint64_t key, int &eval)
+{
+    const auto &entry = entries_[key & (SIZE - 1)];
+
+    ++probes;
+    if (entry.key == static_cast<uint32_t>(key >> 32))
+    {
+        ++hits;
+        eval = entry.eval;
+        return true;
+    }
+    return false;
+}
+
+void EvalCache::store(uint64_t key, int eval)
+{
+    entries_[key & (SIZE - 1)] = {static_cast<uint32_t>(key >> 32), eval};
+}
+
+void EvalCache::clear()
+{
+    std::fill(entries_.begin(), entries_.end(), Entry{});
+}
+
+namespace
+{
+    // Everything that only depends on the position itself, not on how the game got there.
+    int evaluatePosition(const EvalBoard &board, PawnTable &pawns)
+    {
+        // piece counts alone settle bare kings and the endgames with a dedicated evaluator
+        const auto material = material_table.probe(board.materialKey());
+        if (material.insufficient)
+        {
+            return DRAW_SCORE;
+        }
+        if (material.endgame)
+        {
+            return material.endgame(board);
+        }
+
+        if (network.loaded())
+        {
+            const int score = network.evaluate(board.accumulator(), board.sideToMove());
+            return board.sideToMove() == Color::WHITE ? score : -score;
+        }
+
+        // material and piece-square tables, kept up to date by the board itself
+        int mg = board.midgame() + material.imbalance;
+        int eg = board.endgame() + material.imbalance;
+
+        addMobility<Color::WHITE>(board, mg, eg);
+        addMobility<Color::BLACK>(board, mg, eg);
+
+        // doubled, isolated, backward and passed pawns, nearly always a hash hit
+        const auto &pawn_entry = pawns.probe(board);
+        mg += pawn_entry.mg;
+        eg += pawn_entry.eg;
+
+        // blended from midgame to endgame as pieces come off
+        const int phase = material.phase;
+        int score = (mg * phase + eg * (PHASE_MAX - phase)) / PHASE_MAX;
+
+        // drawish material pulls the side that is ahead towards zero
+        int scale = material.scale[Color(score > 0 ? Color::WHITE : Color::BLACK)];
+        if (material.bishops_only)
+        {
+            const auto white_bishop = board.pieces(PieceType::BISHOP, Color::WHITE).lsb();
+            const auto black_bishop = board.pieces(PieceType::BISHOP, Color::BLACK).lsb();
+            if (!Square::same_color(white_bishop, black_bishop))
+            {
+                scale = std::min(scale, SCALE_NORMAL / 2);
+            }
+        }
+        score = score * scale / SCALE_NORMAL;
+
+        return score;
+    }
+}
+
+int evaluate(const EvalBoard &board, PawnTable &pawns, EvalCache &cache)
+{
+    // checkmates are scored by the search, which knows how far away they are
+    if (board.isHalfMoveDraw() && board.getHalfMoveDrawType().first != GameResultReason::CHECKMATE)
+    {
+        return DRAW_SCORE;
+    }
+
+    if (board.isRepetition())
+    {
+        return DRAW_SCORE;
+    }
+
+    // the draws above depend on the game history, so only what follows is cached
+    int score;
+    if (cache.probe(board.hash(), score))
+    {
+        return score;
+    }
+
+    score = evaluatePosition(board, pawns);
+    cache.store(board.hash(), score);
+    return score;
+}
@@ -0,0 +1,98 @@
+#ifndef EVALUATE_HPP
+#define EVALUATE_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "chess.hpp"
+#include "material.hpp"
+#include "nnue.hpp"
+#include "pawns.hpp"
+
+// Indexed by PieceType, king and none are worth nothing for exchanges.
+constexpr std::array<int, 7> PIECE_VALUE = {100, 300, 300, 500, 900, 0, 0};
+
+// A Board that keeps material and piece-square sums, and the network's accumulator once a
+// network is loaded, up to date on every piece placed or removed, so that the static eval
+// doesn't have to look at the whole board. BasicBoard calls the hooks below without any
+// virtual dispatch.
+class EvalBoard : public chess::BasicBoard<EvalBoard>
+{
+public:
+    explicit EvalBoard(std::string_view fen = chess::constants::STARTPOS);
+
+    // Takes over the position and its history, and recomputes the sums.
+    EvalBoard &operator=(const chess::Board &board);
+
+    bool setFen(std::string_view fen);
+
+    // White's sums minus black's.
+    int midgame() const { return mg_; }
+    int endgame() const { return eg_; }
+
+    const Accumulator &accumulator() const { return accumulator_; }
+
+    // Board::Position plus the sums, for copy-make: saved before a move, and restored
+    // instead of unmaking it. The accumulator is only copied while a network is loaded.
+    struct Snapshot
+    {
+        chess::Board::Position position;
+        int mg;
+        int eg;
+        Accumulator accumulator;
+    };
+
+    void save(Snapshot &snapshot) const;
+
+    // Undoes the last move, which has to be the one made right after snapshot was saved.
+    void restore(const Snapshot &snapshot);
+
+private:
+    friend class chess::Board; // calls the hooks
+
+    void onPlacePiece(chess::Piece piece, chess::Square sq) { account(piece, sq, 1); }
+    void onRemovePiece(chess::Piece piece, chess::Square sq) { account(piece, sq, -1); }
+
+    // Adds (sign 1) or subtracts (sign -1) what piece on sq is worth.
+    void account(chess::Piece piece, chess::Square sq, int sign);
+    void refresh();
+
+    int mg_ = 0;
+    int eg_ = 0;
+    Accumulator accumulator_;
+};
+
+// Static evals of recently seen positions, white's point of view, keyed by Board::hash().
+// Lossy: a position simply overwrites whatever shared its slot. Every search thread has
+// its own, no locking needed.
+class EvalCache
+{
+public:
+    EvalCache() : entries_(SIZE) {}
+
+    bool probe(uint64_t key, int &eval);
+    void store(uint64_t key, int eval);
+    void clear();
+
+    uint64_t hits = 0;
+    uint64_t probes = 0;
+
+private:
+    // the lower bits of the hash select the slot, the upper half is kept to verify it
+    struct Entry
+    {
+        uint32_t key = 0;
+        int32_t eval = 0;
+    };
+
+    static constexpr size_t SIZE = 1 << 16; // power of two, 512 KB
+
+    std::vector<Entry> entries_;
+};
+
+// Static evaluation from white's point of view. pawns and cache belong to the calling thread.
+int evaluate(const EvalBoard &board, PawnTable &pawns, EvalCache &cache);
+
+#endif
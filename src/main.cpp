@@ -1,52 +1,29 @@
 #include <iostream>
 #include <string>
 #include <iosfwd>
-#include <limits.h>
-#include <random>
 #include <algorithm>
 #include <chrono>
-#include <unordered_map>
 #include <memory>
 #include <numeric>
+#include <thread>
 
+#include "bench.hpp"
 #include "chess.hpp"
+#include "nnue.hpp"
+#include "search.hpp"
+#include "thread.hpp"
+#include "timeman.hpp"
+#include "tt.hpp"
+#include "types.hpp"
 
 using namespace chess;
 
-constexpr auto DRAW_SCORE = 0;
-constexpr auto INF = INT_MAX;
-constexpr auto DEPTH = 32; // half-moves
+constexpr auto MAX_THREADS = 1024;
 
 constexpr auto STARTER_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
-struct BestMove
-{
-    Move move;
-    int eval;
-};
-
-enum class EntryFlag
-{
-    EXACT,
-    LOWER_BOUND,
-    UPPER_BOUND
-};
-
-struct TTEntry
-{
-    int eval;
-    int depth;
-    EntryFlag flag;
-};
-
 static Board current_board = Board(STARTER_FEN);
 
-std::unique_ptr<std::unordered_map<uint64_t, TTEntry>> transposition_table;
-
-static std::mt19937 rng(std::random_device{}());
-
-static std::vector<int64_t> movetimes;
-
 std::vector<std::string> split_by_space(const std::string &input)
 {
     std::istringstream iss(input);
@@ -59,241 +36,142 @@ std::vector<std::string> split_by_space(const std::string &input)
     return tokens;
 }
 
-int evaluate(Board &board, const Movelist &moves)
+// Parameters may come in any order, and any of them may be missing.
+SearchLimits parseGo(const std::vector<std::string> &commands)
 {
-    // todo: make it evaluate from sidetomove perspective
-    if (board.isHalfMoveDraw())
-    {
-        return board.getHalfMoveDrawType().first == GameResultReason::CHECKMATE ? -INF : DRAW_SCORE;
-    }
-
-    if (board.isRepetition())
-    {
-        return DRAW_SCORE;
-    }
+    SearchLimits limits;
+    limits.start = std::chrono::high_resolution_clock::now();
 
-    // no moves means game over
-    if (moves.empty())
+    for (size_t i = 1; i < commands.size(); ++i)
     {
-        return board.inCheck() ? -INF : DRAW_SCORE;
-    }
-
-    int score = 0;
-
-    score += board.pieces(PieceType::PAWN, Color::WHITE).count() * 100;
-    score += board.pieces(PieceType::KNIGHT, Color::WHITE).count() * 300;
-    score += board.pieces(PieceType::BISHOP, Color::WHITE).count() * 300;
-    score += board.pieces(PieceType::ROOK, Color::WHITE).count() * 500;
-    score += board.pieces(PieceType::QUEEN, Color::WHITE).count() * 900;
-
-    score -= board.pieces(PieceType::PAWN, Color::BLACK).count() * 100;
-    score -= board.pieces(PieceType::KNIGHT, Color::BLACK).count() * 300;
-    score -= board.pieces(PieceType::BISHOP, Color::BLACK).count() * 300;
-    score -= board.pieces(PieceType::ROOK, Color::BLACK).count() * 500;
-    score -= board.pieces(PieceType::QUEEN, Color::BLACK).count() * 900;
-
-    // doubled pawns (only immediately doubled)
-    auto w_pawns = board.pieces(PieceType::PAWN, Color::WHITE);
-    auto w_pawns_north = w_pawns << static_cast<uint8_t>(Direction::NORTH);
-    auto w_doubled = w_pawns & w_pawns_north;
-
-    auto b_pawns = board.pieces(PieceType::PAWN, Color::BLACK);
-    auto b_pawns_north = b_pawns << static_cast<uint8_t>(Direction::SOUTH);
-    auto b_doubled = b_pawns & b_pawns_north;
-
-    score -= w_doubled.count() * 50;
-    score += b_doubled.count() * 50;
-
-    // blocked pawns
-
-    // isolated pawns
-
-    // number of legal moves
-    board.makeNullMove(); // I guess this is flawed too...
-    Movelist their_moves;
-    movegen::legalmoves(their_moves, board);
-    board.unmakeNullMove();
-
-    auto moves_difference = moves.size() - their_moves.size();
-    board.sideToMove() == Color::WHITE ? score += moves_difference * 10 : score -= moves_difference * 10;
-
-    return score;
-}
-
-int negamax(Board &board, int depth, int alpha, int beta, std::chrono::time_point<std::chrono::high_resolution_clock> time_limit)
-{
-    int alphaOrig = alpha;
+        const auto &token = commands[i];
+        if (token == "infinite")
+        {
+            limits.infinite = true;
+            continue;
+        }
 
-    // (* Transposition Table Lookup; node is the lookup key for ttEntry *)
-    // ttEntry := transpositionTableLookup(node)
-    // if ttEntry.is_valid and ttEntry.depth ≥ depth then
-    //     if ttEntry.flag = EXACT then
-    //         return ttEntry.value
-    //     else if ttEntry.flag = LOWERBOUND and ttEntry.value ≥ beta then
-    //         return ttEntry.value
-    //     else if ttEntry.flag = UPPERBOUND and ttEntry.value ≤ alpha then
-    //         return ttEntry.value
-    const auto hash = board.hash();
-    const auto it = transposition_table->find(hash);
-    if (it != transposition_table->end() && it->second.depth >= depth)
-    {
-        auto &tt_entry = it->second;
+        // everything else is followed by a number
+        if (i + 1 >= commands.size())
+        {
+            break;
+        }
+        const auto &value = commands[i + 1];
 
-        if (tt_entry.flag == EntryFlag::EXACT)
+        if (token == "wtime")
         {
-            return tt_entry.eval;
+            limits.time[Color(Color::WHITE)] = std::max(0, std::stoi(value));
+            limits.timed = true;
         }
-        else if (tt_entry.flag == EntryFlag::LOWER_BOUND && tt_entry.eval >= beta)
+        else if (token == "btime")
         {
-            return tt_entry.eval;
+            limits.time[Color(Color::BLACK)] = std::max(0, std::stoi(value));
+            limits.timed = true;
         }
-        else if (tt_entry.flag == EntryFlag::UPPER_BOUND && tt_entry.eval <= alpha)
+        else if (token == "winc")
         {
-            return tt_entry.eval;
+            limits.inc[Color(Color::WHITE)] = std::max(0, std::stoi(value));
         }
-    }
-
-    Movelist moves;
-    movegen::legalmoves(moves, board);
-
-    if (depth == 0)
-    {
-        return board.sideToMove() == Color::WHITE ? evaluate(board, moves) : -evaluate(board, moves);
-    }
-
-    int max = -INF;
-
-    for (const auto &move : moves)
-    {
-        board.makeMove(move);
-        int score = -negamax(board, depth - 1, -beta, -alpha, time_limit);
-        board.unmakeMove(move);
-
-        if (score > max)
+        else if (token == "binc")
         {
-            max = score;
+            limits.inc[Color(Color::BLACK)] = std::max(0, std::stoi(value));
         }
-        if (score > alpha)
+        else if (token == "movestogo")
         {
-            alpha = score;
+            limits.movestogo = std::stoi(value);
         }
-        if (alpha >= beta)
+        else if (token == "movetime")
         {
-            break; // Beta cutoff
+            limits.movetime = std::stoi(value);
         }
-    }
-
-    // (* Transposition Table Store; node is the lookup key for ttEntry *)
-    // ttEntry.value := value
-    // if value ≤ alphaOrig then
-    //     ttEntry.flag := UPPERBOUND
-    // else if value ≥ β then
-    //     ttEntry.flag := LOWERBOUND
-    // else
-    //     ttEntry.flag := EXACT
-    // ttEntry.depth := depth
-    // ttEntry.is_valid := true
-    // transpositionTableStore(node, ttEntry)
-
-    if ((it != transposition_table->end() && it->second.depth < depth) || it == transposition_table->end())
-    { // is this if needed? investigate
-        TTEntry tt_entry;
-        tt_entry.eval = max;
-        if (tt_entry.eval <= alphaOrig)
+        else if (token == "depth")
         {
-            tt_entry.flag = EntryFlag::UPPER_BOUND;
+            limits.depth = std::clamp(std::stoi(value), 1, MAX_PLY - 1);
         }
-        else if (tt_entry.eval >= beta)
+        else if (token == "nodes")
         {
-            tt_entry.flag = EntryFlag::LOWER_BOUND;
+            limits.nodes = std::stoull(value);
+        }
+        else if (token == "mate")
+        {
+            limits.mate = std::stoi(value);
         }
         else
         {
-            tt_entry.flag = EntryFlag::EXACT;
+            continue;
         }
-        tt_entry.depth = depth;
-
-        (*transposition_table)[hash] = tt_entry;
+        ++i;
     }
 
-    return max;
+    return limits;
 }
 
-BestMove findBestMove(Board &board, int depth, int time, int inc)
+void go(const SearchLimits &limits)
 {
+    transposition_table.newSearch();
+    // returns right away, the main search thread prints bestmove when it is done
+    threads.startSearch(current_board, limits);
+}
 
-    auto get_time_limit = [](int time, int inc)
-    { return std::chrono::milliseconds{time / 20 + inc / 2}; };
-
-    Movelist moves;
-    movegen::legalmoves(moves, board);
-
-    Move bestMoveOverall;
-
-    // std::shuffle(moves.begin(), moves.end(), rng);
-
-    const auto time_limit = std::chrono::high_resolution_clock::now() + get_time_limit(time, inc);
-    auto iter = 1;
-    int bestValueOverall = -INF;
-
-    while (iter <= depth)
+void setOption(const std::vector<std::string> &commands)
+{
+    // option names and values may contain spaces: setoption name <id> [value <x>]
+    std::string name;
+    std::string value;
+    std::string *target = nullptr;
+    for (auto it = commands.begin() + 1; it != commands.end(); ++it)
     {
-
-
-        int bestValueNew = -INF;
-        Move bestMoveNew;
-        int alpha = -INF + 1;
-        int beta = INF;
-
-        for (const auto &move : moves)
+        if (*it == "name")
         {
-            if (time_limit < std::chrono::high_resolution_clock::now())
-            {
-                break;
-            }
-
-            board.makeMove(move);
-            int moveValue = -negamax(board, iter - 1, -beta, -alpha, time_limit);
-            std::cout << moveValue <<  " " << uci::moveToUci(move) << "\n";
-            board.unmakeMove(move);
-            if (moveValue > bestValueNew)
-            {
-                bestValueNew = moveValue;
-                bestMoveNew = move;
-            }
-            if (moveValue > alpha)
-            {
-                alpha = moveValue;
-            }
-            if (alpha >= beta)
-            {
-                break;
-            }
-
-
+            target = &name;
         }
-        if (time_limit < std::chrono::high_resolution_clock::now())
+        else if (*it == "value")
         {
-            break;
+            target = &value;
         }
+        else if (target)
+        {
+            *target += target->empty() ? *it : " " + *it;
+        }
+    }
 
-        std::cout << "depth " << iter++ << " currmove " << uci::moveToUci(bestMoveNew) << "\n";
-        bestMoveOverall = bestMoveNew;
-        bestValueOverall = bestValueNew;
-    };
+    // resizing under a running search would pull the table out from under it
+    threads.main().waitForSearchFinished();
 
-    return {.move = bestMoveOverall, .eval = bestValueOverall};
-}
+    if (name == "Hash")
+    {
+        transposition_table.resize(std::stoul(value), threads.size());
+    }
+    if (name == "Threads")
+    {
+        threads.resize(std::clamp(std::stoi(value), 1, MAX_THREADS));
+    }
+    if (name == "Move Overhead")
+    {
+        time_manager.move_overhead = std::clamp(std::stoi(value), 0, TimeManager::MAX_MOVE_OVERHEAD);
+    }
+    if (name == "CopyMake")
+    {
+        threads.copy_make = value == "true";
+    }
+    if (name == "EvalFile" && value != "<empty>")
+    {
+        const bool loaded = network.load(value);
+        if (loaded)
+        {
+            threads.clear(); // the cached evals came from the previous evaluation
+        }
 
-void go(int wtime, int btime, int winc, int binc)
-{
-    const auto side_to_move = current_board.sideToMove();
-    const auto starttime = std::chrono::high_resolution_clock::now();
-    const auto bestmove = findBestMove(current_board, DEPTH, side_to_move == Color::WHITE ? wtime : btime, side_to_move == Color::WHITE ? winc : binc);
-    const auto duration = (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - starttime)).count();
-    std::cout << "info score cp " << bestmove.eval << " time " << duration << "\n";
-    std::cout << "bestmove " << uci::moveToUci(bestmove.move) << "\n";
-    movetimes.push_back(duration);
+        std::lock_guard<std::mutex> lock(io_mutex);
+        if (loaded)
+        {
+            std::cout << "info string loaded network " << value << " using " << network.kernelName() << std::endl;
+        }
+        else
+        {
+            std::cout << "info string could not load network " << value << ", keeping the current evaluation" << std::endl;
+        }
+    }
 }
 
 void parseCommand(const std::string &input)
@@ -302,25 +180,47 @@ void parseCommand(const std::string &input)
     auto main_command = commands.front();
     if (main_command == "uci")
     {
+        std::lock_guard<std::mutex> lock(io_mutex);
         std::cout << "id name kockasfulu\n";
-        std::cout << "uciok\n";
+        std::cout << "option name Hash type spin default " << TranspositionTable::DEFAULT_MB << " min 1 max " << TranspositionTable::MAX_MB << "\n";
+        std::cout << "option name Threads type spin default 1 min 1 max " << MAX_THREADS << "\n";
+        std::cout << "option name Move Overhead type spin default " << TimeManager::DEFAULT_MOVE_OVERHEAD << " min 0 max " << TimeManager::MAX_MOVE_OVERHEAD << "\n";
+        std::cout << "option name EvalFile type string default <empty>\n";
+        std::cout << "option name CopyMake type check default " << (threads.copy_make ? "true" : "false") << "\n";
+        std::cout << "uciok" << std::endl;
     }
     if (main_command == "isready")
     {
-        std::cout << "readyok\n";
+        // answered right away, even while searching
+        std::lock_guard<std::mutex> lock(io_mutex);
+        std::cout << "readyok" << std::endl;
     }
     if (main_command == "ucinewgame")
     {
+        threads.main().waitForSearchFinished();
         current_board = Board(STARTER_FEN);
+        transposition_table.clear(threads.size());
+        threads.clear();
     }
-    if (main_command == "position")
+    if (main_command == "setoption")
+    {
+        setOption(commands);
+    }
+    if (main_command == "position" && commands.size() > 1)
     {
         if (commands[1] == "fen")
         {
-            current_board = Board(commands[2] + " " + commands[3] + " " + commands[4] + " " + commands[5] + " " + commands[6]);
-            if (commands.size() > 7)
+            // the FEN runs up to "moves", GUIs may leave out the move counters
+            const auto moves_begin = std::find(commands.begin() + 2, commands.end(), "moves");
+            std::string fen;
+            for (auto it = commands.begin() + 2; it != moves_begin; ++it)
+            {
+                fen += (fen.empty() ? "" : " ") + *it;
+            }
+            current_board = Board(fen);
+            if (moves_begin != commands.end())
             {
-                for (auto it = commands.begin() + 9; it != commands.end(); ++it)
+                for (auto it = moves_begin + 1; it != commands.end(); ++it)
                 {
                     auto move = uci::uciToMove(current_board, *it);
                     current_board.makeMove(move);
@@ -350,33 +250,52 @@ void parseCommand(const std::string &input)
 
     if (main_command == "go")
     {
-        if (commands[1] == "infinite")
+        go(parseGo(commands));
+    }
+    if (main_command == "perft" && commands.size() > 1)
+    {
+        threads.main().waitForSearchFinished();
+        perft(current_board, std::stoi(commands[1]));
+    }
+    if (main_command == "bench")
+    {
+        threads.main().waitForSearchFinished();
+        if (commands.size() > 1 && commands[1] == "evasions")
         {
-            go(INF, INF, INF, INF);
+            benchEvasions();
         }
         else
         {
-
-            go(std::stoi(commands[2]) /*wtime*/, std::stoi(commands[4]) /*btime*/, std::stoi(commands[6]) /*winc*/, std::stoi(commands[8]) /*binc*/);
+            bench(commands.size() > 1 ? std::stoi(commands[1]) : BENCH_DEPTH);
         }
     }
     if (main_command == "stop")
     {
+        threads.stop = true;
     }
     if (main_command == "quit")
     {
-        std::cout << std::accumulate(movetimes.begin(), movetimes.end(), 0) / movetimes.size() << "\n";
+        threads.stop = true;
+        threads.main().waitForSearchFinished();
+        if (!movetimes.empty())
+        {
+            std::cout << std::accumulate(movetimes.begin(), movetimes.end(), 0) / movetimes.size() << "\n";
+        }
         exit(0);
     }
 }
 
 int main()
 {
-    transposition_table = std::make_unique<std::unordered_map<uint64_t, TTEntry>>();
+    threads.resize(1);
+    transposition_table.resize(TranspositionTable::DEFAULT_MB, std::thread::hardware_concurrency());
     while (true)
     {
         std::string command;
-        std::getline(std::cin, command);
+        if (!std::getline(std::cin, command))
+        {
+            command = "quit"; // stdin closed
+        }
         if (!command.empty())
         {
             parseCommand(command);
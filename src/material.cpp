@@ -0,0 +1,360 @@
+#include "material.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include "evaluate.hpp"
+#include "types.hpp"
+
+using namespace chess;
+
+const MaterialTable material_table;
+
+namespace
+{
+    // Piece types as plain indices into PIECE_VALUE and the count arrays.
+    enum : int
+    {
+        PAWN,
+        KNIGHT,
+        BISHOP,
+        ROOK,
+        QUEEN,
+        KING
+    };
+
+    // Largest piece counts per color that the precomputed table covers.
+    constexpr std::array<int, 5> MAX_COUNT = {8, 2, 2, 2, 1};
+    constexpr int SIDE_ENTRIES = 9 * 3 * 3 * 3 * 2;
+
+    constexpr std::array<int, 6> PHASE_INC = {0, 1, 1, 2, 4, 0};
+
+    constexpr int BISHOP_PAIR = 40;
+    constexpr int KNIGHT_PAWN_BONUS = 4; // per knight and per pawn above five, knights like closed positions
+    constexpr int ROOK_PAWN_BONUS = 3;   // per rook and per pawn below five, rooks like open ones
+    constexpr int REDUNDANT_ROOK = 10;
+
+    // Far above any positional score, far below the mate scores.
+    constexpr int KNOWN_WIN = 10000;
+
+    // counts[color][PieceType]
+    using Counts = std::array<std::array<int, 6>, 2>;
+
+    Counts decode(uint64_t key)
+    {
+        Counts counts{};
+        for (int color = 0; color < 2; ++color)
+        {
+            for (int type = 0; type < 6; ++type)
+            {
+                counts[color][type] = (key >> (4 * (color * 6 + type))) & 0xF;
+            }
+        }
+        return counts;
+    }
+
+    int nonPawnMaterial(const std::array<int, 6> &count)
+    {
+        int material = 0;
+        for (int type = KNIGHT; type <= QUEEN; ++type)
+        {
+            material += count[type] * PIECE_VALUE[type];
+        }
+        return material;
+    }
+
+    int material(const Board &board, Color color)
+    {
+        const auto counts = decode(board.materialKey());
+        return counts[color][PAWN] * PIECE_VALUE[PAWN] + nonPawnMaterial(counts[color]);
+    }
+
+    // Bigger the closer sq is to the edge, and the closer the two squares are to each other.
+    int pushToEdge(Square sq)
+    {
+        const int file = sq.file();
+        const int rank = sq.rank();
+        return 20 * (std::max(3 - file, file - 4) + std::max(3 - rank, rank - 4));
+    }
+
+    int pushClose(Square a, Square b) { return 10 * (7 - Square::distance(a, b)); }
+
+    constexpr int sign(Color color) { return color == Color::WHITE ? 1 : -1; }
+
+    // Mating material against a bare king: drive it to the edge and bring our king closer.
+    template <Color::underlying strong>
+    int evaluateKXK(const Board &board)
+    {
+        constexpr Color us = strong;
+        const auto strong_king = board.kingSq(us);
+        const auto weak_king = board.kingSq(~us);
+
+        const int score = KNOWN_WIN + material(board, us) + pushToEdge(weak_king) + pushClose(strong_king, weak_king);
+        return sign(us) * score;
+    }
+
+    // Bishop and knight: only the corners of the bishop's color are mating corners.
+    template <Color::underlying strong>
+    int evaluateKBNK(const Board &board)
+    {
+        constexpr Color us = strong;
+        const auto strong_king = board.kingSq(us);
+        const auto weak_king = board.kingSq(~us);
+        const auto bishop = board.pieces(PieceType::BISHOP, us).lsb();
+
+        const auto corners = Square(bishop).is_dark() ? std::array<Square, 2>{Square::SQ_A1, Square::SQ_H8}
+                                                       : std::array<Square, 2>{Square::SQ_A8, Square::SQ_H1};
+        const int corner_distance = std::min(Square::distance(weak_king, corners[0]), Square::distance(weak_king, corners[1]));
+
+        const int score = KNOWN_WIN + material(board, us) + 40 * (7 - corner_distance) + pushClose(strong_king, weak_king);
+        return sign(us) * score;
+    }
+
+    // King and pawn against king, approximated with the rule of the square and the key
+    // squares instead of a bitbase. Anything not proven won is scored as nearly drawn.
+    template <Color::underlying strong>
+    int evaluateKPK(const Board &board)
+    {
+        constexpr Color us = strong;
+
+        // everything from the strong side's point of view, pawn moving up the board
+        const auto pawn = Square(board.pieces(PieceType::PAWN, us).lsb()).relative_square(us);
+        const auto strong_king = board.kingSq(us).relative_square(us);
+        const auto weak_king = board.kingSq(~us).relative_square(us);
+        const bool weak_to_move = board.sideToMove() != us;
+
+        const int file = pawn.file();
+        const int rank = pawn.rank();
+        const int king_file = strong_king.file();
+        const int king_rank = strong_king.rank();
+        const auto queening = Square(56 + file);
+
+        const int won = sign(us) * (KNOWN_WIN + PIECE_VALUE[PAWN] + 20 * rank);
+        const int drawish = sign(us) * (PIECE_VALUE[PAWN] / 4 + 5 * rank);
+
+        // the defending king can't catch the pawn and our king isn't in its way
+        const int pawn_moves = 7 - rank - (rank == 1);
+        const bool path_clear = king_file != file || king_rank < rank;
+        if (path_clear && Square::distance(weak_king, queening) - weak_to_move > pawn_moves)
+        {
+            return won;
+        }
+
+        // a rook pawn is a draw once the defending king gets to the corner
+        if ((file == 0 || file == 7) && Square::distance(weak_king, queening) <= 1)
+        {
+            return DRAW_SCORE;
+        }
+
+        // the pawn is about to be taken
+        if (weak_to_move && Square::distance(weak_king, pawn) == 1 && Square::distance(strong_king, pawn) > 1)
+        {
+            return DRAW_SCORE;
+        }
+
+        // our king on a key square wins: two ranks in front of the pawn on the same or a
+        // neighbouring file, or one rank in front once the pawn has crossed the middle
+        if (file != 0 && file != 7 && std::abs(king_file - file) <= 1)
+        {
+            const int ahead = king_rank - rank;
+            if (ahead == 2 || (rank >= 4 && ahead == 1))
+            {
+                return won;
+            }
+        }
+
+        return drawish;
+    }
+
+    // Queen against rook is a win, but a long one: corner the king and keep ours close.
+    template <Color::underlying strong>
+    int evaluateKQKR(const Board &board)
+    {
+        constexpr Color us = strong;
+        const auto strong_king = board.kingSq(us);
+        const auto weak_king = board.kingSq(~us);
+
+        const int score = PIECE_VALUE[QUEEN] - PIECE_VALUE[ROOK] + pushToEdge(weak_king) +
+                          pushClose(strong_king, weak_king);
+        return sign(us) * score;
+    }
+
+    template <Color::underlying strong>
+    EndgameFn findEndgame(const Counts &counts)
+    {
+        constexpr Color us = strong;
+        const auto &ours = counts[us];
+        const auto &theirs = counts[~us];
+
+        const int our_npm = nonPawnMaterial(ours);
+        const int their_npm = nonPawnMaterial(theirs);
+        const bool they_are_bare = theirs[PAWN] == 0 && their_npm == 0;
+
+        if (they_are_bare)
+        {
+            if (ours[PAWN] == 0 && our_npm == PIECE_VALUE[KNIGHT] + PIECE_VALUE[BISHOP] &&
+                ours[KNIGHT] == 1)
+            {
+                return &evaluateKBNK<strong>;
+            }
+            if (ours[PAWN] == 1 && our_npm == 0)
+            {
+                return &evaluateKPK<strong>;
+            }
+            // two knights can't force mate
+            const bool knights_only = ours[PAWN] == 0 && our_npm == ours[KNIGHT] * PIECE_VALUE[KNIGHT] && ours[KNIGHT] <= 2;
+            if (our_npm >= PIECE_VALUE[ROOK] && !knights_only)
+            {
+                return &evaluateKXK<strong>;
+            }
+        }
+
+        if (ours[PAWN] == 0 && theirs[PAWN] == 0 && our_npm == PIECE_VALUE[QUEEN] &&
+            ours[QUEEN] == 1 && their_npm == PIECE_VALUE[ROOK] && theirs[ROOK] == 1)
+        {
+            return &evaluateKQKR<strong>;
+        }
+
+        return nullptr;
+    }
+
+    MaterialEntry compute(const Counts &counts)
+    {
+        MaterialEntry entry;
+
+        int phase = 0;
+        int imbalance = 0;
+        for (const Color color : {Color::WHITE, Color::BLACK})
+        {
+            const auto &count = counts[color];
+            for (int type = 0; type < 6; ++type)
+            {
+                phase += PHASE_INC[type] * count[type];
+            }
+
+            int bonus = 0;
+            if (count[BISHOP] >= 2)
+            {
+                bonus += BISHOP_PAIR;
+            }
+            bonus += KNIGHT_PAWN_BONUS * count[KNIGHT] * (count[PAWN] - 5);
+            bonus += ROOK_PAWN_BONUS * count[ROOK] * (5 - count[PAWN]);
+            if (count[ROOK] >= 2)
+            {
+                bonus -= REDUNDANT_ROOK;
+            }
+            imbalance += sign(color) * bonus;
+        }
+        entry.phase = std::min(phase, PHASE_MAX);
+        entry.imbalance = imbalance;
+
+        const auto &white = counts[Color(Color::WHITE)];
+        const auto &black = counts[Color(Color::BLACK)];
+        const int npm[2] = {nonPawnMaterial(white), nonPawnMaterial(black)};
+        const bool no_pawns = white[PAWN] == 0 && black[PAWN] == 0;
+
+        // bare kings, or a single minor piece against a bare king
+        entry.insufficient = no_pawns && npm[0] + npm[1] <= PIECE_VALUE[BISHOP] &&
+                             white[ROOK] + white[QUEEN] + black[ROOK] + black[QUEEN] == 0;
+
+        entry.endgame = findEndgame<Color::WHITE>(counts);
+        if (!entry.endgame)
+        {
+            entry.endgame = findEndgame<Color::BLACK>(counts);
+        }
+
+        // Without pawns a small material edge rarely wins: a minor piece ahead is a draw,
+        // and so are two knights against a bare king.
+        for (const Color color : {Color::WHITE, Color::BLACK})
+        {
+            const auto &count = counts[color];
+            const int us = npm[color];
+            const int them = npm[~color];
+            if (count[PAWN] == 0 && us - them <= PIECE_VALUE[BISHOP])
+            {
+                entry.scale[color] = us < PIECE_VALUE[ROOK] ? SCALE_DRAW : them <= PIECE_VALUE[BISHOP] ? 4 : 14;
+            }
+            if (count[PAWN] == 0 && us == 2 * PIECE_VALUE[KNIGHT] && count[KNIGHT] == 2 && them == 0)
+            {
+                entry.scale[color] = SCALE_DRAW;
+            }
+        }
+
+        entry.bishops_only = npm[0] == PIECE_VALUE[BISHOP] && white[BISHOP] == 1 &&
+                             npm[1] == PIECE_VALUE[BISHOP] && black[BISHOP] == 1;
+
+        return entry;
+    }
+
+    // Position of one color's counts in the table, which has to cover them.
+    size_t tableIndex(const std::array<int, 6> &count)
+    {
+        size_t index = 0;
+        for (int type = PAWN; type <= QUEEN; ++type)
+        {
+            assert(count[type] >= 0 && count[type] <= MAX_COUNT[type]);
+            index = index * (MAX_COUNT[type] + 1) + count[type];
+        }
+        return index;
+    }
+
+    // Position of one color's counts in the table, -1 if it has more of something than the table covers.
+    int sideIndex(const std::array<int, 6> &count)
+    {
+        for (int type = PAWN; type <= QUEEN; ++type)
+        {
+            if (count[type] > MAX_COUNT[type])
+            {
+                return -1;
+            }
+        }
+        return static_cast<int>(tableIndex(count));
+    }
+
+    // Just the two kings.
+    Counts emptyCounts()
+    {
+        Counts counts{};
+        counts[0][KING] = counts[1][KING] = 1;
+        return counts;
+    }
+
+    // Steps to the next combination of counts within the table like an odometer, false after the last one.
+    bool nextCounts(std::array<int, 6> &count)
+    {
+        for (int type = QUEEN; type >= PAWN; --type)
+        {
+            if (++count[type] <= MAX_COUNT[type])
+            {
+                return true;
+            }
+            count[type] = 0;
+        }
+        return false;
+    }
+}
+
+MaterialTable::MaterialTable() : entries_(SIDE_ENTRIES * SIDE_ENTRIES)
+{
+    auto counts = emptyCounts();
+    do
+    {
+        do
+        {
+            entries_[tableIndex(counts[0]) * SIDE_ENTRIES + tableIndex(counts[1])] = compute(counts);
+        } while (nextCounts(counts[1]));
+    } while (nextCounts(counts[0]));
+}
+
+MaterialEntry MaterialTable::probe(uint64_t key) const
+{
+    const auto counts = decode(key);
+    const int white = sideIndex(counts[0]);
+    const int black = sideIndex(counts[1]);
+    if (white < 0 || black < 0)
+    {
+        return compute(counts);
+    }
+    return entries_[white * SIDE_ENTRIES + black];
+}
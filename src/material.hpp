@@ -0,0 +1,48 @@
+#ifndef MATERIAL_HPP
+#define MATERIAL_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "chess.hpp"
+
+// Game phase of the starting position: 1 per minor piece, 2 per rook and 4 per queen.
+constexpr int PHASE_MAX = 24;
+
+// Scale factors shrink the score of the side that is ahead in drawish material.
+constexpr int SCALE_NORMAL = 64;
+constexpr int SCALE_DRAW = 0;
+
+// Evaluates a known endgame from white's point of view instead of the generic eval.
+using EndgameFn = int (*)(const chess::Board &board);
+
+// Everything that only depends on how many pieces of each kind are on the board.
+struct MaterialEntry
+{
+    EndgameFn endgame = nullptr;
+    int16_t imbalance = 0; // white's point of view, added to midgame and endgame alike
+    uint8_t phase = 0;     // 0 to PHASE_MAX
+    uint8_t scale[2] = {SCALE_NORMAL, SCALE_NORMAL}; // applied when that color is ahead
+    bool bishops_only = false; // one bishop each and no other pieces, maybe of opposite colors
+    bool insufficient = false; // no sequence of legal moves can mate
+};
+
+static_assert(sizeof(MaterialEntry) == 16);
+
+// Every material signature within a normal game's piece counts, computed once at startup.
+// Signatures beyond that, after promotions to a third knight for example, are computed on demand.
+class MaterialTable
+{
+public:
+    MaterialTable();
+
+    // key is Board::materialKey().
+    MaterialEntry probe(uint64_t key) const;
+
+private:
+    std::vector<MaterialEntry> entries_;
+};
+
+extern const MaterialTable material_table;
+
+#endif
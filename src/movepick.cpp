@@ -0,0 +1,270 @@
+#include "movepick.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "evaluate.hpp"
+#include "see.hpp"
+
+using namespace chess;
+
+int16_t mvvLva(const Board &board, Move move)
+{
+    const auto victim = move.typeOf() == Move::ENPASSANT ? PieceType(PieceType::PAWN) : board.at<PieceType>(move.to());
+    const auto attacker = board.at<PieceType>(move.from());
+    const auto promotion = move.typeOf() == Move::PROMOTION ? PIECE_VALUE[move.promotionType()] : 0;
+    return static_cast<int16_t>(16 * (PIECE_VALUE[victim] + promotion) - static_cast<int>(attacker));
+}
+
+MovePicker::MovePicker(const Board &board, Move tt_move, const Move *killers, Move counter,
+                       const ButterflyHistory &history, const std::array<const PieceToHistory *, 2> &continuation)
+    : board_(board), history_(history), continuation_(continuation), tt_move_(tt_move), killers_{killers[0], killers[1]},
+      counter_(counter), in_check_(board.inCheck())
+{
+}
+
+MovePicker::MovePicker(const Board &board, Move tt_move, const ButterflyHistory &history, bool in_check,
+                       bool quiet_checks, Square recapture)
+    : board_(board), history_(history), tt_move_(tt_move), skip_quiets_(!in_check), in_check_(in_check),
+      quiet_checks_(quiet_checks && !in_check)
+{
+    if (recapture != Square::NO_SQ && !in_check)
+    {
+        targets_ = Bitboard::fromSquare(recapture);
+        if (tt_move_ != Move::NO_MOVE && tt_move_.to() != recapture)
+        {
+            tt_move_ = Move::NO_MOVE;
+        }
+    }
+}
+
+Move MovePicker::next()
+{
+    while (true)
+    {
+        switch (stage_)
+        {
+        case Stage::TT_MOVE:
+            stage_ = in_check_ ? Stage::GENERATE_EVASIONS : Stage::GENERATE_CAPTURES;
+            // handed out before anything is generated, most nodes cut off right here
+            if ((!skip_quiets_ || !isQuiet(tt_move_)) && isLegal(tt_move_))
+            {
+                return tt_move_;
+            }
+            tt_move_ = Move::NO_MOVE;
+            break;
+
+        case Stage::GENERATE_CAPTURES:
+            movegen::targetmoves<movegen::MoveGenType::CAPTURE>(moves_, board_, targets_);
+            for (auto &move : moves_)
+            {
+                move.setScore(mvvLva(board_, move));
+            }
+            index_ = 0;
+            end_ = moves_.size();
+            stage_ = Stage::CAPTURES;
+            break;
+
+        case Stage::CAPTURES:
+            while (index_ < end_)
+            {
+                const auto move = pickBest();
+                if (move == tt_move_)
+                {
+                    continue;
+                }
+                if (!see(board_, move, 0))
+                {
+                    // not even worth a look in quiescence
+                    if (!skip_quiets_)
+                    {
+                        bad_captures_.add(move);
+                    }
+                    continue;
+                }
+                return move;
+            }
+            stage_ = !skip_quiets_ ? Stage::KILLER_1 : quiet_checks_ ? Stage::GENERATE_QUIET_CHECKS : Stage::DONE;
+            break;
+
+        case Stage::KILLER_1:
+        case Stage::KILLER_2:
+        {
+            const auto move = killers_[stage_ == Stage::KILLER_1 ? 0 : 1];
+            stage_ = stage_ == Stage::KILLER_1 ? Stage::KILLER_2 : Stage::COUNTER_MOVE;
+            if (move != tt_move_ && isQuiet(move) && isLegal(move))
+            {
+                return move;
+            }
+            break;
+        }
+
+        case Stage::COUNTER_MOVE:
+            stage_ = Stage::GENERATE_QUIETS;
+            if (counter_ != tt_move_ && counter_ != killers_[0] && counter_ != killers_[1] && isQuiet(counter_) &&
+                isLegal(counter_))
+            {
+                return counter_;
+            }
+            break;
+
+        case Stage::GENERATE_QUIETS:
+        {
+            movegen::legalmoves<movegen::MoveGenType::QUIET>(moves_, board_);
+            for (auto &move : moves_)
+            {
+                move.setScore(quietScore(move));
+            }
+            index_ = 0;
+            end_ = moves_.size();
+            stage_ = Stage::QUIETS;
+            break;
+        }
+
+        case Stage::QUIETS:
+            while (index_ < end_)
+            {
+                const auto move = pickBest();
+                if (!alreadyPicked(move))
+                {
+                    return move;
+                }
+            }
+            index_ = 0;
+            stage_ = Stage::BAD_CAPTURES;
+            break;
+
+        case Stage::BAD_CAPTURES:
+            if (index_ < bad_captures_.size())
+            {
+                return bad_captures_[index_++];
+            }
+            stage_ = Stage::DONE;
+            break;
+
+        case Stage::GENERATE_EVASIONS:
+        {
+            movegen::legalmoves<movegen::MoveGenType::EVASIONS>(moves_, board_);
+
+            // captures go first, by MVV-LVA, and the quiets after them by history
+            const auto quiets = std::partition(moves_.begin(), moves_.end(),
+                                               [&](const Move &move) { return board_.isCapture(move); });
+            for (auto move = moves_.begin(); move != moves_.end(); ++move)
+            {
+                move->setScore(move < quiets ? mvvLva(board_, *move) : quietScore(*move));
+            }
+            index_ = 0;
+            end_ = static_cast<int>(quiets - moves_.begin());
+            stage_ = Stage::EVASIONS;
+            break;
+        }
+
+        case Stage::EVASIONS:
+            while (index_ < moves_.size())
+            {
+                if (index_ == end_)
+                {
+                    end_ = moves_.size();
+                }
+                const auto move = pickBest();
+                if (move != tt_move_)
+                {
+                    return move;
+                }
+            }
+            stage_ = Stage::DONE;
+            break;
+
+        case Stage::GENERATE_QUIET_CHECKS:
+            movegen::quietchecks(moves_, board_);
+            for (auto &move : moves_)
+            {
+                move.setScore(quietScore(move));
+            }
+            index_ = 0;
+            end_ = moves_.size();
+            stage_ = Stage::QUIET_CHECKS;
+            break;
+
+        case Stage::QUIET_CHECKS:
+            while (index_ < end_)
+            {
+                const auto move = pickBest();
+                if (move != tt_move_ && see(board_, move, 0))
+                {
+                    return move;
+                }
+            }
+            stage_ = Stage::DONE;
+            break;
+
+        case Stage::DONE:
+            return Move::NO_MOVE;
+        }
+    }
+}
+
+bool MovePicker::isLegal(Move move) const
+{
+    if (move == Move::NO_MOVE || move == Move::NULL_MOVE)
+    {
+        return false;
+    }
+
+    const auto piece = board_.at(move.from());
+    if (piece == Piece::NONE || piece.color() != board_.sideToMove())
+    {
+        return false;
+    }
+
+    // only the moving piece's type is generated, which is far cheaper than a full generation
+    Movelist legal;
+    movegen::legalmoves(legal, board_, 1 << static_cast<int>(piece.type()));
+    return std::find(legal.begin(), legal.end(), move) != legal.end();
+}
+
+bool MovePicker::isQuiet(Move move) const
+{
+    return !board_.isCapture(move);
+}
+
+bool MovePicker::alreadyPicked(Move move) const
+{
+    return move == tt_move_ || move == killers_[0] || move == killers_[1] || move == counter_;
+}
+
+// Butterfly plus continuation history, queen promotions first and underpromotions last.
+int16_t MovePicker::quietScore(Move move) const
+{
+    if (move.typeOf() == Move::PROMOTION)
+    {
+        return move.promotionType() == PieceType::QUEEN ? std::numeric_limits<int16_t>::max()
+                                                         : std::numeric_limits<int16_t>::min();
+    }
+
+    int score = history_[board_.sideToMove()][move.from().index()][move.to().index()];
+    for (const auto *table : continuation_)
+    {
+        if (table)
+        {
+            score += (*table)[board_.at(move.from())][move.to().index()];
+        }
+    }
+    return static_cast<int16_t>(score / 2); // three tables summed, halved to fit the move's int16 score
+}
+
+// Moves the best scored move of moves_[index_, end_) to the front and returns it. Cheaper
+// than sorting everything up front when a cutoff usually comes after a few moves.
+Move MovePicker::pickBest()
+{
+    int best = index_;
+    for (int i = index_ + 1; i < end_; ++i)
+    {
+        if (moves_[i].score() > moves_[best].score())
+        {
+            best = i;
+        }
+    }
+    std::swap(moves_[index_], moves_[best]);
+    return moves_[index_++];
+}
@@ -0,0 +1,98 @@
+#ifndef MOVEPICK_HPP
+#define MOVEPICK_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+#include "chess.hpp"
+
+// history[color][from][to]: how well a quiet move has done in cutoffs so far.
+using ButterflyHistory = std::array<std::array<std::array<int16_t, 64>, 64>, 2>;
+
+// [piece][to] of a quiet move: how well it did as the reply to one particular earlier move.
+using PieceToHistory = std::array<std::array<int16_t, 64>, 12>;
+
+// continuation[piece][to] of the move one or two plies back, the PieceToHistory of its replies.
+using ContinuationHistory = std::array<std::array<PieceToHistory, 64>, 12>;
+
+// countermoves[piece][to] of the previous move: the quiet move that refuted it last time.
+using CounterMoveTable = std::array<std::array<chess::Move, 64>, 12>;
+
+constexpr int HISTORY_MAX = 1 << 14;
+
+// Gravity: moves entry towards bonus, the less the closer it already is to +-HISTORY_MAX,
+// so that entries stay bounded and recent results outweigh old ones.
+inline void updateHistory(int16_t &entry, int bonus)
+{
+    entry = static_cast<int16_t>(entry + bonus - entry * std::abs(bonus) / HISTORY_MAX);
+}
+
+// Most valuable victim first, least valuable attacker breaking ties.
+int16_t mvvLva(const chess::Board &board, chess::Move move);
+
+// Hands out legal moves one at a time, best guess first, generating each batch
+// only when the previous ones are used up so that early cutoffs skip movegen.
+class MovePicker
+{
+public:
+    // Main search: hash move, captures that don't lose material, killers, countermove,
+    // quiets by butterfly and continuation history, then the losing captures. In check the
+    // hash move, then the evasions, captures before quiets.
+    // continuation holds the tables of the moves one and two plies back, nullptr where there is none.
+    MovePicker(const chess::Board &board, chess::Move tt_move, const chess::Move *killers, chess::Move counter,
+               const ButterflyHistory &history, const std::array<const PieceToHistory *, 2> &continuation = {});
+
+    // Quiescence: hash move and the captures that don't lose material, then with quiet_checks
+    // the quiet checks that don't either. Given a recapture square only the captures landing
+    // there are generated. In check every evasion is handed out.
+    MovePicker(const chess::Board &board, chess::Move tt_move, const ButterflyHistory &history, bool in_check,
+               bool quiet_checks = false, chess::Square recapture = chess::Square::NO_SQ);
+
+    // Move::NO_MOVE once every move has been handed out.
+    chess::Move next();
+
+private:
+    enum class Stage : uint8_t
+    {
+        TT_MOVE,
+        GENERATE_CAPTURES,
+        CAPTURES,
+        KILLER_1,
+        KILLER_2,
+        COUNTER_MOVE,
+        GENERATE_QUIETS,
+        QUIETS,
+        BAD_CAPTURES,
+        GENERATE_EVASIONS,
+        EVASIONS,
+        GENERATE_QUIET_CHECKS,
+        QUIET_CHECKS,
+        DONE
+    };
+
+    bool isLegal(chess::Move move) const;
+    bool isQuiet(chess::Move move) const;
+    bool alreadyPicked(chess::Move move) const;
+    int16_t quietScore(chess::Move move) const;
+    chess::Move pickBest();
+
+    const chess::Board &board_;
+    const ButterflyHistory &history_;
+    std::array<const PieceToHistory *, 2> continuation_ = {};
+    chess::Move tt_move_;
+    chess::Move killers_[2] = {chess::Move::NO_MOVE, chess::Move::NO_MOVE};
+    chess::Move counter_ = chess::Move::NO_MOVE;
+    bool skip_quiets_ = false;
+    bool in_check_ = false;
+    bool quiet_checks_ = false;
+    chess::Bitboard targets_ = ~chess::Bitboard(0ULL); // where generated captures may land
+    Stage stage_ = Stage::TT_MOVE;
+
+    chess::Movelist moves_;
+    chess::Movelist bad_captures_; // losing captures by SEE, kept aside during CAPTURES
+    int index_ = 0;
+    int end_ = 0; // pickBest only looks at moves_[index_, end_)
+};
+
+#endif
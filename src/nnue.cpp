@@ -0,0 +1,273 @@
+#include "nnue.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "types.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NNUE_X86
+#endif
+
+using namespace chess;
+
+namespace
+{
+    constexpr uint32_t MAGIC = 0x45554E4B; // "KNUE"
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = 4 * sizeof(uint32_t);
+    constexpr size_t FILE_SIZE = HEADER_SIZE + sizeof(int16_t) * (NNUE_INPUTS * NNUE_HIDDEN + NNUE_HIDDEN + 2 * NNUE_HIDDEN) +
+                                 sizeof(int32_t);
+
+    // Quantization: hidden activations are clipped to [0, QA], output weights are scaled by QB.
+    constexpr int QA = 255;
+    constexpr int QB = 64;
+    constexpr int EVAL_SCALE = 400;
+
+    // One implementation per instruction set, picked once at startup. All of them work on a
+    // whole NNUE_HIDDEN row, which is a multiple of every vector width.
+    struct Kernels
+    {
+        const char *name;
+        void (*add)(int16_t *acc, const int16_t *row);
+        void (*sub)(int16_t *acc, const int16_t *row);
+        int32_t (*dot)(const int16_t *acc, const int16_t *weights); // sum of clamp(acc, 0, QA) * weights
+    };
+
+    void addScalar(int16_t *acc, const int16_t *row)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; ++i)
+        {
+            acc[i] += row[i];
+        }
+    }
+
+    void subScalar(int16_t *acc, const int16_t *row)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; ++i)
+        {
+            acc[i] -= row[i];
+        }
+    }
+
+    int32_t dotScalar(const int16_t *acc, const int16_t *weights)
+    {
+        int32_t sum = 0;
+        for (int i = 0; i < NNUE_HIDDEN; ++i)
+        {
+            sum += std::clamp<int32_t>(acc[i], 0, QA) * weights[i];
+        }
+        return sum;
+    }
+
+#ifdef NNUE_X86
+    __attribute__((target("sse4.1"))) void addSse41(int16_t *acc, const int16_t *row)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; i += 8)
+        {
+            const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+            const auto r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), _mm_add_epi16(a, r));
+        }
+    }
+
+    __attribute__((target("sse4.1"))) void subSse41(int16_t *acc, const int16_t *row)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; i += 8)
+        {
+            const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+            const auto r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), _mm_sub_epi16(a, r));
+        }
+    }
+
+    __attribute__((target("sse4.1"))) int32_t dotSse41(const int16_t *acc, const int16_t *weights)
+    {
+        const auto zero = _mm_setzero_si128();
+        const auto qa = _mm_set1_epi16(QA);
+        auto sum = _mm_setzero_si128();
+        for (int i = 0; i < NNUE_HIDDEN; i += 8)
+        {
+            auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+            a = _mm_min_epi16(_mm_max_epi16(a, zero), qa);
+            const auto w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + i));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(a, w));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        return _mm_cvtsi128_si32(sum);
+    }
+
+    __attribute__((target("avx2"))) void addAvx2(int16_t *acc, const int16_t *row)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; i += 16)
+        {
+            const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + i));
+            const auto r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + i), _mm256_add_epi16(a, r));
+        }
+    }
+
+    __attribute__((target("avx2"))) void subAvx2(int16_t *acc, const int16_t *row)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; i += 16)
+        {
+            const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + i));
+            const auto r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc + i), _mm256_sub_epi16(a, r));
+        }
+    }
+
+    __attribute__((target("avx2"))) int32_t dotAvx2(const int16_t *acc, const int16_t *weights)
+    {
+        const auto zero = _mm256_setzero_si256();
+        const auto qa = _mm256_set1_epi16(QA);
+        auto sum = _mm256_setzero_si256();
+        for (int i = 0; i < NNUE_HIDDEN; i += 16)
+        {
+            auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc + i));
+            a = _mm256_min_epi16(_mm256_max_epi16(a, zero), qa);
+            const auto w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + i));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, w));
+        }
+        auto half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+        return _mm_cvtsi128_si32(half);
+    }
+#endif
+
+    Kernels selectKernels()
+    {
+#ifdef NNUE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return {"avx2", addAvx2, subAvx2, dotAvx2};
+        }
+        if (__builtin_cpu_supports("sse4.1"))
+        {
+            return {"sse4.1", addSse41, subSse41, dotSse41};
+        }
+#endif
+        return {"scalar", addScalar, subScalar, dotScalar};
+    }
+
+    // defined before network below, so it is initialized first
+    const Kernels KERNELS = selectKernels();
+}
+
+Network network;
+
+Network::~Network()
+{
+    unmap();
+}
+
+bool Network::load(const std::string &path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) != FILE_SIZE)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(nullptr, FILE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file alive
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    uint32_t header[4];
+    std::memcpy(header, mapping, sizeof(header));
+    if (header[0] != MAGIC || header[1] != VERSION || header[2] != NNUE_HIDDEN)
+    {
+        munmap(mapping, FILE_SIZE);
+        return false;
+    }
+
+    unmap();
+    mapping_ = mapping;
+    mapping_size_ = FILE_SIZE;
+
+    const auto *data = reinterpret_cast<const int16_t *>(static_cast<const char *>(mapping) + HEADER_SIZE);
+    feature_weights_ = data;
+    feature_bias_ = feature_weights_ + NNUE_INPUTS * NNUE_HIDDEN;
+    output_weights_ = feature_bias_ + NNUE_HIDDEN;
+    std::memcpy(&output_bias_, output_weights_ + 2 * NNUE_HIDDEN, sizeof(output_bias_));
+    return true;
+}
+
+const char *Network::kernelName() const
+{
+    return KERNELS.name;
+}
+
+void Network::unmap()
+{
+    if (mapping_)
+    {
+        munmap(mapping_, mapping_size_);
+    }
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+    feature_weights_ = feature_bias_ = output_weights_ = nullptr;
+    output_bias_ = 0;
+}
+
+const int16_t *Network::featureRow(Color perspective, Square king_sq, Piece piece, Square sq) const
+{
+    // black sees the board upside down, and its own pieces come first just like white's
+    const int flip = perspective == Color::WHITE ? 0 : 56;
+    const int relative_piece = static_cast<int>(piece.type()) + (piece.color() == perspective ? 0 : 6);
+    const int index = ((king_sq.index() ^ flip) * 12 + relative_piece) * 64 + (sq.index() ^ flip);
+    return feature_weights_ + static_cast<size_t>(index) * NNUE_HIDDEN;
+}
+
+void Network::refresh(Accumulator &acc, const Board &board, Color perspective) const
+{
+    auto &values = acc.values[perspective];
+    std::copy_n(feature_bias_, NNUE_HIDDEN, values.begin());
+
+    const auto king_sq = board.kingSq(perspective);
+    auto occupied = board.occ();
+    while (occupied)
+    {
+        const auto sq = Square(occupied.pop());
+        KERNELS.add(values.data(), featureRow(perspective, king_sq, board.at(sq), sq));
+    }
+}
+
+void Network::addPiece(Accumulator &acc, Color perspective, Square king_sq, Piece piece, Square sq) const
+{
+    KERNELS.add(acc.values[perspective].data(), featureRow(perspective, king_sq, piece, sq));
+}
+
+void Network::removePiece(Accumulator &acc, Color perspective, Square king_sq, Piece piece, Square sq) const
+{
+    KERNELS.sub(acc.values[perspective].data(), featureRow(perspective, king_sq, piece, sq));
+}
+
+int Network::evaluate(const Accumulator &acc, Color side_to_move) const
+{
+    int64_t output = output_bias_;
+    output += KERNELS.dot(acc.values[side_to_move].data(), output_weights_);
+    output += KERNELS.dot(acc.values[~side_to_move].data(), output_weights_ + NNUE_HIDDEN);
+    // a net gone wild must not pass for a mate score, nor overflow the 16 bit fields of the TT
+    output = output * EVAL_SCALE / (QA * QB);
+    return static_cast<int>(std::clamp<int64_t>(output, -MATE_IN_MAX_PLY + 1, MATE_IN_MAX_PLY - 1));
+}
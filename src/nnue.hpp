@@ -0,0 +1,75 @@
+#ifndef NNUE_HPP
+#define NNUE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "chess.hpp"
+
+// HalfKA inputs: (own king square, piece, square) seen from each side, mirrored vertically
+// for black so that both perspectives share the weights.
+constexpr int NNUE_INPUTS = 64 * 12 * 64;
+constexpr int NNUE_HIDDEN = 256;
+
+// Hidden layer pre-activations of both perspectives, indexed by Color. Kept up to date
+// piece by piece instead of being summed over the whole board at every leaf.
+struct Accumulator
+{
+    alignas(32) std::array<std::array<int16_t, NNUE_HIDDEN>, 2> values;
+};
+
+// Efficiently updatable network: the input layer above, a clipped ReLU, and one output
+// neuron over the side to move's half followed by the other side's half.
+//
+// The weights are memory-mapped straight from the file, little endian int16:
+//   header        "KNUE", version, NNUE_HIDDEN, 0  (four uint32)
+//   feature       NNUE_INPUTS x NNUE_HIDDEN weights, then NNUE_HIDDEN biases
+//   output        2 x NNUE_HIDDEN weights, then one int32 bias
+class Network
+{
+public:
+    Network() = default;
+    Network(const Network &) = delete;
+    Network &operator=(const Network &) = delete;
+    ~Network();
+
+    // Maps the network in path, keeping the current one if path can't be used.
+    bool load(const std::string &path);
+
+    // Until a network is loaded the handcrafted evaluation is used.
+    bool loaded() const { return feature_weights_ != nullptr; }
+
+    // Name of the SIMD kernels picked for this CPU.
+    const char *kernelName() const;
+
+    // Recomputes perspective's half from every piece on the board, after its king moved.
+    void refresh(Accumulator &acc, const chess::Board &board, chess::Color perspective) const;
+
+    // Adds or removes piece on sq in perspective's half, whose king stands on king_sq.
+    void addPiece(Accumulator &acc, chess::Color perspective, chess::Square king_sq, chess::Piece piece,
+                  chess::Square sq) const;
+    void removePiece(Accumulator &acc, chess::Color perspective, chess::Square king_sq, chess::Piece piece,
+                     chess::Square sq) const;
+
+    // Centipawns from side_to_move's point of view, always short of a mate score.
+    int evaluate(const Accumulator &acc, chess::Color side_to_move) const;
+
+private:
+    void unmap();
+    const int16_t *featureRow(chess::Color perspective, chess::Square king_sq, chess::Piece piece,
+                              chess::Square sq) const;
+
+    void *mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+
+    const int16_t *feature_weights_ = nullptr;
+    const int16_t *feature_bias_ = nullptr;
+    const int16_t *output_weights_ = nullptr;
+    int32_t output_bias_ = 0;
+};
+
+extern Network network;
+
+#endif
@@ -0,0 +1,124 @@
+#include "pawns.hpp"
+
+#include <array>
+
+using namespace chess;
+
+namespace
+{
+    constexpr uint64_t FILE_A = 0x0101010101010101ULL;
+    constexpr uint64_t FILE_H = FILE_A << 7;
+
+    constexpr int DOUBLED_MG = -10;
+    constexpr int DOUBLED_EG = -25;
+    constexpr int ISOLATED_MG = -10;
+    constexpr int ISOLATED_EG = -15;
+    constexpr int BACKWARD_MG = -8;
+    constexpr int BACKWARD_EG = -10;
+
+    // Passed pawn bonus by rank, seen from the pawn's own side.
+    constexpr std::array<int, 8> PASSED_MG = {0, 5, 10, 15, 25, 40, 60, 0};
+    constexpr std::array<int, 8> PASSED_EG = {0, 10, 15, 25, 45, 75, 110, 0};
+
+    constexpr uint64_t north(uint64_t b) { return b << 8; }
+    constexpr uint64_t south(uint64_t b) { return b >> 8; }
+    constexpr uint64_t east(uint64_t b) { return (b & ~FILE_H) << 1; }
+    constexpr uint64_t west(uint64_t b) { return (b & ~FILE_A) >> 1; }
+
+    constexpr uint64_t northFill(uint64_t b)
+    {
+        b |= b << 8;
+        b |= b << 16;
+        b |= b << 32;
+        return b;
+    }
+
+    constexpr uint64_t southFill(uint64_t b)
+    {
+        b |= b >> 8;
+        b |= b >> 16;
+        b |= b >> 32;
+        return b;
+    }
+
+    constexpr uint64_t fileFill(uint64_t b) { return northFill(b) | southFill(b); }
+
+    // Everything in front of the pawns, from color's point of view.
+    constexpr uint64_t frontSpan(uint64_t b, Color color)
+    {
+        return color == Color::WHITE ? northFill(north(b)) : southFill(south(b));
+    }
+
+    constexpr uint64_t pawnAttacks(uint64_t b, Color color)
+    {
+        const auto forward = color == Color::WHITE ? north(b) : south(b);
+        return east(forward) | west(forward);
+    }
+
+    constexpr uint64_t stopSquares(uint64_t b, Color color) { return color == Color::WHITE ? north(b) : south(b); }
+
+    int popcount(uint64_t b) { return Bitboard(b).count(); }
+
+    // Set-wise pawn terms of one color, added to mg and eg with the given sign.
+    void evaluateSide(uint64_t us, uint64_t them, Color color, int sign, PawnEntry &entry)
+    {
+        const auto our_front = frontSpan(us, color);
+        const auto their_front = frontSpan(them, ~color);
+        const auto our_attacks = pawnAttacks(us, color);
+        const auto their_attacks = pawnAttacks(them, ~color);
+
+        // every pawn with a friendly pawn in front of it on the same file
+        const int doubled = popcount(us & our_front);
+
+        // no friendly pawn on either neighbouring file
+        const auto files = fileFill(us);
+        const int isolated = popcount(us & ~east(files) & ~west(files));
+
+        // can't advance safely and no friendly pawn can ever come up to defend it
+        const auto attack_span = frontSpan(our_attacks, color) | our_attacks;
+        const auto unsafe_stops = stopSquares(us, color) & their_attacks & ~attack_span;
+        const int backward = popcount(us & stopSquares(unsafe_stops, ~color));
+
+        // no enemy pawn in front of it on the same or a neighbouring file, and for doubled
+        // pawns only the front one counts
+        const auto blockers = their_front | east(their_front) | west(their_front);
+        const auto passed = us & ~blockers & ~frontSpan(us, ~color);
+
+        int mg = doubled * DOUBLED_MG + isolated * ISOLATED_MG + backward * BACKWARD_MG;
+        int eg = doubled * DOUBLED_EG + isolated * ISOLATED_EG + backward * BACKWARD_EG;
+
+        auto remaining = Bitboard(passed);
+        while (remaining)
+        {
+            const auto sq = Square(remaining.pop());
+            const int rank = static_cast<int>(sq.rank()) ^ (color == Color::WHITE ? 0 : 7);
+            mg += PASSED_MG[rank];
+            eg += PASSED_EG[rank];
+        }
+
+        entry.mg += sign * mg;
+        entry.eg += sign * eg;
+    }
+}
+
+const PawnEntry &PawnTable::probe(const Board &board)
+{
+    const auto key = board.pawnKey();
+    auto &entry = entries_[key & (SIZE - 1)];
+
+    ++probes;
+    if (entry.key == key)
+    {
+        ++hits;
+        return entry;
+    }
+
+    const auto white = board.pieces(PieceType::PAWN, Color::WHITE).getBits();
+    const auto black = board.pieces(PieceType::PAWN, Color::BLACK).getBits();
+
+    entry = {};
+    entry.key = key;
+    evaluateSide(white, black, Color::WHITE, 1, entry);
+    evaluateSide(black, white, Color::BLACK, -1, entry);
+    return entry;
+}
@@ -0,0 +1,36 @@
+#ifndef PAWNS_HPP
+#define PAWNS_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "chess.hpp"
+
+// Pawn structure evaluation of one pawn configuration, white's point of view.
+struct PawnEntry
+{
+    uint64_t key = 0; // Board::pawnKey() of the position, 0 for an empty slot
+    int mg = 0;
+    int eg = 0;
+};
+
+// Pawn structures repeat all over the search tree, so their evaluation is cached by the
+// pawn key. Every search thread has its own table, no locking needed.
+class PawnTable
+{
+public:
+    PawnTable() : entries_(SIZE) {}
+
+    // The cached entry of board's pawn structure, evaluated first on a miss.
+    const PawnEntry &probe(const chess::Board &board);
+
+    uint64_t hits = 0;
+    uint64_t probes = 0;
+
+private:
+    static constexpr size_t SIZE = 1 << 14; // power of two, 256 KB
+
+    std::vector<PawnEntry> entries_;
+};
+
+#endif
@@ -0,0 +1,928 @@
+#include "search.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "evaluate.hpp"
+#include "movepick.hpp"
+#include "see.hpp"
+#include "thread.hpp"
+#include "timeman.hpp"
+#include "tt.hpp"
+
+using namespace chess;
+
+std::vector<int64_t> movetimes;
+
+namespace
+{
+    // Helper threads skip some iterations so that they run ahead of the main thread
+    // at different depths instead of all searching the same tree in lockstep.
+    constexpr int SKIP_SIZE[] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+    constexpr int SKIP_PHASE[] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+    bool skipIteration(size_t thread_id, int depth)
+    {
+        if (thread_id == 0)
+        {
+            return false;
+        }
+
+        const auto i = (thread_id - 1) % std::size(SKIP_SIZE);
+        return ((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2;
+    }
+
+    // Nodes between two looks at the stop flag, the clock and the node limit. Small enough
+    // to overshoot the hard limit by a few ms at most. Every thread runs on until its next
+    // look, so a node limit is overshot by up to threads * interval nodes and gets polled
+    // far more often.
+    constexpr int LIMITS_CHECK_INTERVAL = 1024;
+    constexpr int NODES_CHECK_INTERVAL = 32;
+
+    // Half width of the first aspiration window, and the first iteration that uses one.
+    constexpr int ASPIRATION_DELTA = 25;
+    constexpr int ASPIRATION_MIN_DEPTH = 4;
+
+    // Captures that are worse than this even after winning the victim can't raise alpha.
+    constexpr int DELTA_MARGIN = 200;
+
+    // Quiescence also tries quiet checks at its first ply, and from QS_RECAPTURE_PLY plies
+    // in on only recaptures on the square the last move went to.
+    constexpr int QS_RECAPTURE_PLY = 4;
+
+    // Null move pruning starts at NMP_MIN_DEPTH, from NMP_VERIFY_DEPTH on a fail high
+    // has to be confirmed by a reduced normal search before it is trusted.
+    constexpr int NMP_MIN_DEPTH = 3;
+    constexpr int NMP_VERIFY_DEPTH = 12;
+
+    // Near the leaves, moves that lose more than this much in exchanges are skipped once
+    // one move has been searched. Quiet moves are let through with a little less.
+    constexpr int SEE_PRUNE_DEPTH = 6;
+    constexpr int SEE_CAPTURE_MARGIN = 100; // per ply of depth
+    constexpr int SEE_QUIET_MARGIN = 20;    // per ply of depth squared
+
+    // History bonus of a cutoff, growing with depth but kept well below HISTORY_MAX so
+    // that a single cutoff can't saturate an entry.
+    constexpr int HISTORY_BONUS_SCALE = 16;
+    constexpr int HISTORY_BONUS_MAX = HISTORY_MAX / 8;
+
+    // std::log isn't constexpr, ln(x) = 2 * atanh((x - 1) / (x + 1)) converges quickly once x is below 2
+    constexpr double constexprLog(double x)
+    {
+        constexpr double LN_2 = 0.6931471805599453;
+
+        double result = 0.0;
+        while (x > 2.0)
+        {
+            x /= 2.0;
+            result += LN_2;
+        }
+
+        const double y = (x - 1.0) / (x + 1.0);
+        double term = y;
+        for (int k = 1; k < 40; k += 2)
+        {
+            result += 2.0 * term / k;
+            term *= y * y;
+        }
+        return result;
+    }
+
+    // Late move reductions: the later a move comes in the ordering and the deeper the
+    // search, the less likely it is to be best, so it gets a shallower search first.
+    constexpr int LMR_MIN_DEPTH = 3;
+    constexpr int LMR_TABLE_SIZE = 64;
+
+    constexpr auto LMR_TABLE = []
+    {
+        std::array<std::array<int, LMR_TABLE_SIZE>, LMR_TABLE_SIZE> table{};
+        for (int depth = 1; depth < LMR_TABLE_SIZE; ++depth)
+        {
+            for (int move_number = 1; move_number < LMR_TABLE_SIZE; ++move_number)
+            {
+                table[depth][move_number] =
+                    static_cast<int>(0.75 + constexprLog(depth) * constexprLog(move_number) / 2.25);
+            }
+        }
+        return table;
+    }();
+
+    int lmrReduction(int depth, int move_number)
+    {
+        return LMR_TABLE[std::min(depth, LMR_TABLE_SIZE - 1)][std::min(move_number, LMR_TABLE_SIZE - 1)];
+    }
+
+
+    // "cp <x>", or "mate <n>" in full moves, negative when we are the one getting mated.
+    std::string scoreToUci(int score)
+    {
+        if (!isMateScore(score))
+        {
+            return "cp " + std::to_string(score);
+        }
+        return "mate " + std::to_string(score > 0 ? (MATE - score + 1) / 2 : -(MATE + score) / 2);
+    }
+
+    // One "info" line for the last completed iteration of worker, with the totals of all threads.
+    void printInfo(const Worker &worker)
+    {
+        const auto elapsed = time_manager.elapsed();
+        const auto nodes = threads.nodesSearched();
+
+        std::lock_guard<std::mutex> lock(io_mutex);
+        std::cout << "info depth " << worker.completed_depth << " seldepth " << worker.seldepth
+                  << " score " << scoreToUci(worker.best.eval) << " nodes " << nodes
+                  << " nps " << nodes * 1000 / std::max<int64_t>(elapsed, 1) << " hashfull " << transposition_table.hashfull()
+                  << " time " << elapsed << " pv";
+        for (const auto &move : worker.best.pv)
+        {
+            std::cout << " " << uci::moveToUci(move);
+        }
+        std::cout << "\n";
+    }
+}
+
+void Worker::search(const SearchLimits &limits)
+{
+    findBestMove(limits);
+
+    if (!isMainThread())
+    {
+        return;
+    }
+
+    // the GUI only expects bestmove after it sent "stop"
+    while (limits.infinite && !threads.stop)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    threads.stop = true;
+    threads.waitForHelpers();
+
+    const auto cutoff_rate = cutoffs ? 100.0 * first_move_cutoffs / cutoffs : 0.0;
+    const auto pawn_hit_rate = pawn_table.probes ? 100.0 * pawn_table.hits / pawn_table.probes : 0.0;
+    const auto eval_hit_rate = eval_cache.probes ? 100.0 * eval_cache.hits / eval_cache.probes : 0.0;
+
+    const auto &best_thread = threads.bestThread();
+    const auto &bestmove = best_thread.best;
+    const auto duration = (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - limits.start)).count();
+
+    // the final totals, and the line of the thread whose move is played
+    printInfo(best_thread);
+    {
+        std::lock_guard<std::mutex> lock(io_mutex);
+        std::cout << "info string first move cutoff rate " << cutoff_rate << "%\n";
+        std::cout << "info string pawn hash hit rate " << pawn_hit_rate << "%\n";
+        std::cout << "info string eval cache hit rate " << eval_hit_rate << "%\n";
+        // the UCI null move when checkmated or stalemated at the root
+        std::cout << "bestmove " << (bestmove.move == Move::NO_MOVE ? "0000" : uci::moveToUci(bestmove.move))
+                  << std::endl;
+    }
+    movetimes.push_back(duration);
+}
+
+int Worker::negamax(int depth, int ply, int alpha, int beta)
+{
+    nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    stack[ply].pv_length = 0;
+    seldepth = std::max(seldepth, ply);
+
+    if (checkStop())
+    {
+        return 0;
+    }
+
+    // never the root, which has to come up with a move even in a drawn position
+    if (isDraw())
+    {
+        return DRAW_SCORE;
+    }
+
+    const bool pv_node = beta - alpha > 1;
+
+    // Mate distance pruning: not even mating on the next move can beat a shorter
+    // mate found elsewhere, nor can being mated here be worse than one found already.
+    alpha = std::max(alpha, matedIn(ply));
+    beta = std::min(beta, mateIn(ply + 1));
+    if (alpha >= beta)
+    {
+        return alpha;
+    }
+
+    int alphaOrig = alpha;
+
+    // (* Transposition Table Lookup; node is the lookup key for ttEntry *)
+    // ttEntry := transpositionTableLookup(node)
+    // if ttEntry.is_valid and ttEntry.depth ≥ depth then
+    //     if ttEntry.flag = EXACT then
+    //         return ttEntry.value
+    //     else if ttEntry.flag = LOWERBOUND and ttEntry.value ≥ beta then
+    //         return ttEntry.value
+    //     else if ttEntry.flag = UPPERBOUND and ttEntry.value ≤ alpha then
+    //         return ttEntry.value
+    const auto hash = board.hash();
+    TTData tt_entry;
+    const bool tt_hit = transposition_table.probe(hash, tt_entry);
+    if (tt_hit)
+    {
+        tt_entry.score = scoreFromTT(tt_entry.score, ply);
+    }
+    // PV nodes search on instead, a cutoff would leave their line empty
+    if (!pv_node && tt_hit && tt_entry.depth >= depth)
+    {
+        if (tt_entry.flag == EntryFlag::EXACT)
+        {
+            return tt_entry.score;
+        }
+        else if (tt_entry.flag == EntryFlag::LOWER_BOUND && tt_entry.score >= beta)
+        {
+            return tt_entry.score;
+        }
+        else if (tt_entry.flag == EntryFlag::UPPER_BOUND && tt_entry.score <= alpha)
+        {
+            return tt_entry.score;
+        }
+    }
+
+    if (depth <= 0)
+    {
+        return quiescence(ply, alpha, beta);
+    }
+
+    const auto &previous = stack[ply - 1];
+    const bool in_check = board.inCheck();
+
+    // Null move pruning: if passing still leaves us above beta, a real move will too.
+    // Not in check, where passing is illegal, and not with only pawns left, where
+    // zugzwang makes passing the best move.
+    if (!pv_node && depth >= NMP_MIN_DEPTH && ply >= nmp_min_ply_ && previous.move != Move::NULL_MOVE &&
+        !in_check && board.hasNonPawnMaterial(board.sideToMove()))
+    {
+        const int eval = staticEval(tt_hit, tt_entry);
+        if (eval >= beta)
+        {
+            const int reduction = 3 + depth / 4 + std::min((eval - beta) / 200, 3);
+
+            stack[ply].move = Move::NULL_MOVE;
+            stack[ply].piece = Piece::NONE;
+            board.makeNullMove();
+            int score = -negamax(depth - reduction, ply + 1, -beta, -beta + 1);
+            board.unmakeNullMove();
+
+            if (stopped_)
+            {
+                return 0;
+            }
+
+            if (score >= beta)
+            {
+                // a mate found after passing is not a real mate
+                if (score >= MATE_IN_MAX_PLY)
+                {
+                    score = beta;
+                }
+
+                if (depth < NMP_VERIFY_DEPTH || nmp_min_ply_)
+                {
+                    return score;
+                }
+
+                // verify with null moves switched off for the first part of the subtree
+                nmp_min_ply_ = ply + 3 * (depth - reduction) / 4;
+                const int verified = negamax(depth - reduction, ply, beta - 1, beta);
+                nmp_min_ply_ = 0;
+
+                if (stopped_)
+                {
+                    return 0;
+                }
+
+                if (verified >= beta)
+                {
+                    return score;
+                }
+            }
+        }
+    }
+
+    const Move counter = previous.piece != Piece::NONE ? countermoves[previous.piece][previous.move.to().index()] : Move::NO_MOVE;
+    const std::array<const PieceToHistory *, 2> continuation = {continuationAt(ply - 1), continuationAt(ply - 2)};
+    MovePicker picker(board, tt_hit ? tt_entry.move : Move::NO_MOVE, stack[ply].killers, counter, history, continuation);
+
+    int max = -INF;
+    Move best_move = Move::NO_MOVE;
+    Movelist quiets_tried;
+    int moves_searched = 0;
+
+    for (Move move = picker.next(); move != Move::NO_MOVE; move = picker.next())
+    {
+        const bool quiet = !board.isCapture(move);
+        const int move_history = quiet ? quietHistory(move, continuation) : 0;
+
+        if (!pv_node && !in_check && moves_searched > 0 && depth <= SEE_PRUNE_DEPTH && max > -MATE_IN_MAX_PLY &&
+            !see(board, move, quiet ? -SEE_QUIET_MARGIN * depth * depth : -SEE_CAPTURE_MARGIN * depth))
+        {
+            continue;
+        }
+
+        stack[ply].move = move;
+        stack[ply].piece = board.at(move.from());
+        makeMove(ply, move);
+        int score;
+        if (moves_searched == 0)
+        {
+            score = -negamax(depth - 1, ply + 1, -beta, -alpha);
+        }
+        else
+        {
+            int reduction = 0;
+            if (depth >= LMR_MIN_DEPTH && moves_searched >= (pv_node ? 3 : 2))
+            {
+                reduction = lmrReduction(depth, moves_searched + 1);
+                reduction -= pv_node;
+                reduction -= in_check || board.inCheck();
+                reduction -= !quiet;
+                if (quiet)
+                {
+                    reduction -= move_history / HISTORY_MAX;
+                }
+                reduction = std::clamp(reduction, 0, depth - 2);
+            }
+
+            // PVS: prove with a null window that the move is no better than alpha,
+            // and only pay for a full window search when that fails
+            score = -negamax(depth - 1 - reduction, ply + 1, -alpha - 1, -alpha);
+            if (reduction > 0 && score > alpha)
+            {
+                score = -negamax(depth - 1, ply + 1, -alpha - 1, -alpha);
+            }
+            if (score > alpha && score < beta)
+            {
+                score = -negamax(depth - 1, ply + 1, -beta, -alpha);
+            }
+        }
+        unmakeMove(ply, move);
+        ++moves_searched;
+
+        // the subtree was cut short, its score means nothing
+        if (stopped_)
+        {
+            return 0;
+        }
+
+        if (score > max)
+        {
+            max = score;
+            best_move = move;
+        }
+        if (score > alpha)
+        {
+            alpha = score;
+            if (pv_node)
+            {
+                updatePv(ply, move);
+            }
+        }
+        if (alpha >= beta)
+        {
+            ++cutoffs;
+            first_move_cutoffs += moves_searched == 1;
+            if (quiet)
+            {
+                updateQuietStats(ply, depth, move, quiets_tried);
+            }
+            break; // Beta cutoff
+        }
+
+        if (quiet)
+        {
+            quiets_tried.add(move);
+        }
+    }
+
+    if (moves_searched == 0)
+    {
+        return in_check ? matedIn(ply) : DRAW_SCORE;
+    }
+
+    // (* Transposition Table Store; node is the lookup key for ttEntry *)
+    // ttEntry.value := value
+    // if value ≤ alphaOrig then
+    //     ttEntry.flag := UPPERBOUND
+    // else if value ≥ β then
+    //     ttEntry.flag := LOWERBOUND
+    // else
+    //     ttEntry.flag := EXACT
+    // ttEntry.depth := depth
+    // ttEntry.is_valid := true
+    // transpositionTableStore(node, ttEntry)
+
+    // the replacement policy lives in TranspositionTable::store
+    EntryFlag flag;
+    if (max <= alphaOrig)
+    {
+        flag = EntryFlag::UPPER_BOUND;
+    }
+    else if (max >= beta)
+    {
+        flag = EntryFlag::LOWER_BOUND;
+    }
+    else
+    {
+        flag = EntryFlag::EXACT;
+    }
+
+    transposition_table.store(hash, depth, scoreToTT(max, ply), flag, best_move);
+
+    return max;
+}
+
+int Worker::quiescence(int ply, int alpha, int beta, int qs_ply)
+{
+    nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    stack[ply].pv_length = 0; // the line ends here, captures are not part of it
+    seldepth = std::max(seldepth, ply);
+
+    if (checkStop())
+    {
+        return 0;
+    }
+
+    // evaluate() would catch these too, but in check it is never called
+    if (isDraw())
+    {
+        return DRAW_SCORE;
+    }
+
+    if (ply >= MAX_PLY)
+    {
+        return staticEval();
+    }
+
+    const int alphaOrig = alpha;
+    const auto hash = board.hash();
+
+    // every quiescence result is as deep as any other, so all entries are usable
+    TTData tt_entry;
+    const bool tt_hit = transposition_table.probe(hash, tt_entry);
+    if (tt_hit)
+    {
+        tt_entry.score = scoreFromTT(tt_entry.score, ply);
+        if (tt_entry.flag == EntryFlag::EXACT)
+        {
+            return tt_entry.score;
+        }
+        else if (tt_entry.flag == EntryFlag::LOWER_BOUND && tt_entry.score >= beta)
+        {
+            return tt_entry.score;
+        }
+        else if (tt_entry.flag == EntryFlag::UPPER_BOUND && tt_entry.score <= alpha)
+        {
+            return tt_entry.score;
+        }
+    }
+
+    const bool in_check = board.inCheck();
+
+    int max;
+    int stand_pat = -INF;
+
+    if (in_check)
+    {
+        // standing pat is not an option in check, every evasion has to be searched
+        max = -INF;
+    }
+    else
+    {
+        stand_pat = staticEval(tt_hit, tt_entry);
+        if (stand_pat >= beta)
+        {
+            return stand_pat;
+        }
+        if (stand_pat > alpha)
+        {
+            alpha = stand_pat;
+        }
+        max = stand_pat;
+    }
+
+    const auto recapture = qs_ply >= QS_RECAPTURE_PLY ? stack[ply - 1].move.to() : Square(Square::NO_SQ);
+    MovePicker picker(board, tt_hit ? tt_entry.move : Move::NO_MOVE, history, in_check, qs_ply == 0, recapture);
+    Move best_move = Move::NO_MOVE;
+    int moves_searched = 0;
+
+    for (Move move = picker.next(); move != Move::NO_MOVE; move = picker.next())
+    {
+        ++moves_searched;
+
+        // delta pruning: even winning the victim for free leaves us below alpha
+        if (!in_check && move.typeOf() != Move::PROMOTION && board.isCapture(move))
+        {
+            const auto victim = move.typeOf() == Move::ENPASSANT ? PieceType(PieceType::PAWN) : board.at<PieceType>(move.to());
+            if (stand_pat + PIECE_VALUE[victim] + DELTA_MARGIN <= alpha)
+            {
+                continue;
+            }
+        }
+
+        stack[ply].move = move;
+        stack[ply].piece = board.at(move.from());
+        makeMove(ply, move);
+        int score = -quiescence(ply + 1, -beta, -alpha, qs_ply + 1);
+        unmakeMove(ply, move);
+
+        if (stopped_)
+        {
+            return 0;
+        }
+
+        if (score > max)
+        {
+            max = score;
+            best_move = move;
+        }
+        if (score > alpha)
+        {
+            alpha = score;
+        }
+        if (alpha >= beta)
+        {
+            break;
+        }
+    }
+
+    if (in_check && moves_searched == 0)
+    {
+        return matedIn(ply);
+    }
+
+    EntryFlag flag;
+    if (max <= alphaOrig)
+    {
+        flag = EntryFlag::UPPER_BOUND;
+    }
+    else if (max >= beta)
+    {
+        flag = EntryFlag::LOWER_BOUND;
+    }
+    else
+    {
+        flag = EntryFlag::EXACT;
+    }
+
+    transposition_table.store(hash, 0, scoreToTT(max, ply), flag, best_move);
+
+    return max;
+}
+
+int Worker::searchRoot(Movelist &moves, int depth, int alpha, int beta, Move &best_move)
+{
+    int best_value = -INF;
+    stack[0].pv_length = 0;
+
+    for (int i = 0; i < moves.size(); ++i)
+    {
+        const auto move = moves[i];
+        stack[0].move = move;
+        stack[0].piece = board.at(move.from());
+        makeMove(0, move);
+        int moveValue;
+        if (i == 0)
+        {
+            moveValue = -negamax(depth - 1, 1, -beta, -alpha);
+        }
+        else
+        {
+            moveValue = -negamax(depth - 1, 1, -alpha - 1, -alpha);
+            if (moveValue > alpha && moveValue < beta)
+            {
+                moveValue = -negamax(depth - 1, 1, -beta, -alpha);
+            }
+        }
+        unmakeMove(0, move);
+
+        if (stopped_)
+        {
+            break;
+        }
+
+        if (moveValue > best_value || best_move == Move::NO_MOVE)
+        {
+            best_value = moveValue;
+            best_move = move;
+            updatePv(0, move);
+        }
+        if (moveValue > alpha)
+        {
+            alpha = moveValue;
+        }
+        if (alpha >= beta)
+        {
+            break;
+        }
+    }
+
+    return best_value;
+}
+
+void Worker::findBestMove(const SearchLimits &limits)
+{
+    stopped_ = false;
+    calls_until_check_ = 0; // the first node checks right away
+    copy_make_ = threads.copy_make;
+    seldepth = 0;
+    // root moves in picker order: hash move, captures by MVV-LVA, then quiets by history
+    Movelist moves;
+    TTData tt_entry;
+    const Move tt_move = transposition_table.probe(board.hash(), tt_entry) ? tt_entry.move : Move::NO_MOVE;
+    const Move no_killers[2] = {Move::NO_MOVE, Move::NO_MOVE};
+    MovePicker picker(board, tt_move, no_killers, Move::NO_MOVE, history);
+    for (Move move = picker.next(); move != Move::NO_MOVE; move = picker.next())
+    {
+        moves.add(move);
+    }
+
+    // checkmate or stalemate, nothing to search
+    if (moves.empty())
+    {
+        best = {.move = Move::NO_MOVE, .eval = board.inCheck() ? matedIn(0) : DRAW_SCORE};
+        return;
+    }
+
+    // something to play even if "stop" arrives before the first iteration completes
+    best = {.move = moves[0], .eval = -INF};
+
+    // an infinite search ignores the depth limit and only stops on "stop"
+    const int max_depth = limits.infinite ? MAX_PLY - 1 : limits.depth;
+    auto iter = 1;
+
+    while (iter <= max_depth)
+    {
+        if (skipIteration(id, iter))
+        {
+            iter++;
+            continue;
+        }
+
+        // Aspiration window: expect the score to stay close to the previous iteration's
+        // and widen the side that failed until the result lands inside the window.
+        int delta = ASPIRATION_DELTA;
+        int alpha = -INF;
+        int beta = INF;
+        if (iter >= ASPIRATION_MIN_DEPTH)
+        {
+            alpha = std::max(best.eval - delta, -INF);
+            beta = std::min(best.eval + delta, INF);
+        }
+
+        int bestValueNew;
+        Move bestMoveNew;
+
+        while (true)
+        {
+            bestMoveNew = Move::NO_MOVE;
+            bestValueNew = searchRoot(moves, iter, alpha, beta, bestMoveNew);
+
+            if (stopped_)
+            {
+                break;
+            }
+
+            if (bestValueNew <= alpha && alpha > -INF)
+            {
+                beta = (alpha + beta) / 2;
+                alpha = std::max(bestValueNew - delta, -INF);
+            }
+            else if (bestValueNew >= beta && beta < INF)
+            {
+                beta = std::min(bestValueNew + delta, INF);
+            }
+            else
+            {
+                break;
+            }
+
+            delta *= 2;
+        }
+        if (stopped_)
+        {
+            break;
+        }
+
+        best = {.move = bestMoveNew, .eval = bestValueNew};
+        for (int i = 0; i < stack[0].pv_length; ++i)
+        {
+            best.pv.add(stack[0].pv[i]);
+        }
+        completed_depth = iter++;
+
+        if (isMainThread())
+        {
+            printInfo(*this);
+        }
+
+        // the next iteration starts with this one's best move
+        const auto best_it = std::find(moves.begin(), moves.end(), bestMoveNew);
+        if (best_it != moves.end())
+        {
+            std::rotate(moves.begin(), best_it, best_it + 1);
+        }
+
+        if (isMainThread())
+        {
+            time_manager.update(bestMoveNew, bestValueNew);
+
+            // another iteration would most likely not finish in time
+            if (time_manager.softLimitReached() || (limits.mate && !limits.infinite && bestValueNew >= mateIn(2 * limits.mate - 1)))
+            {
+                threads.stop = true;
+                break;
+            }
+        }
+    };
+}
+
+// Looking at the clock and at the other threads costs far more than a node, so it only
+// happens every LIMITS_CHECK_INTERVAL nodes. In between the last answer is reused.
+bool Worker::checkStop()
+{
+    if (--calls_until_check_ > 0)
+    {
+        return stopped_;
+    }
+    const auto &limits = threads.limits;
+    calls_until_check_ = limits.nodes ? NODES_CHECK_INTERVAL : LIMITS_CHECK_INTERVAL;
+
+    // The node limit is on the whole pool, and any thread may be the one to find it reached,
+    // even while the main thread waits for a core. The clock is left to the main thread.
+    if ((limits.nodes && threads.nodesSearched() >= limits.nodes) || (isMainThread() && time_manager.hardLimitReached()))
+    {
+        threads.stop = true;
+    }
+
+    stopped_ = threads.stop.load(std::memory_order_relaxed);
+    return stopped_;
+}
+
+bool Worker::isDraw() const
+{
+    // a checkmate delivered on the hundredth half-move still wins
+    if (board.isHalfMoveDraw() && board.getHalfMoveDrawType().first != GameResultReason::CHECKMATE)
+    {
+        return true;
+    }
+    // one repetition is enough, whoever could avoid it would have done so the first time
+    return board.isRepetition(1);
+}
+
+int Worker::staticEval()
+{
+    const int eval = evaluate(board, pawn_table, eval_cache);
+    return board.sideToMove() == Color::WHITE ? eval : -eval;
+}
+
+// The TT keeps no static eval, but its score bounds the true value of the position. Where
+// the bound lies beyond the static eval it is the better guess, and an exact score saves
+// evaluating at all.
+int Worker::staticEval(bool tt_hit, const TTData &tt_entry)
+{
+    if (!tt_hit || isMateScore(tt_entry.score))
+    {
+        return staticEval();
+    }
+    if (tt_entry.flag == EntryFlag::EXACT)
+    {
+        return tt_entry.score;
+    }
+
+    const int eval = staticEval();
+    if ((tt_entry.flag == EntryFlag::LOWER_BOUND && tt_entry.score > eval) ||
+        (tt_entry.flag == EntryFlag::UPPER_BOUND && tt_entry.score < eval))
+    {
+        return tt_entry.score;
+    }
+    return eval;
+}
+
+void Worker::updatePv(int ply, Move move)
+{
+    auto &line = stack[ply];
+    const auto &child = stack[ply + 1];
+    line.pv[0] = move;
+    std::copy(child.pv.begin(), child.pv.begin() + child.pv_length, line.pv.begin() + 1);
+    line.pv_length = child.pv_length + 1;
+}
+
+void Worker::updateQuietStats(int ply, int depth, Move move, const Movelist &quiets_tried)
+{
+    auto &killers = stack[ply].killers;
+    if (killers[0] != move)
+    {
+        killers[1] = killers[0];
+        killers[0] = move;
+    }
+
+    const auto &previous = stack[ply - 1];
+    if (previous.piece != Piece::NONE)
+    {
+        countermoves[previous.piece][previous.move.to().index()] = move;
+    }
+
+    // reward the cutoff move and punish the quiets that were tried before it
+    const int bonus = std::min(HISTORY_BONUS_SCALE * depth * depth, HISTORY_BONUS_MAX);
+    auto &side_history = history[board.sideToMove()];
+    const std::array<PieceToHistory *, 2> continuation = {continuationAt(ply - 1), continuationAt(ply - 2)};
+    auto update = [&](Move m, int delta)
+    {
+        updateHistory(side_history[m.from().index()][m.to().index()], delta);
+        for (auto *table : continuation)
+        {
+            if (table)
+            {
+                updateHistory((*table)[board.at(m.from())][m.to().index()], delta);
+            }
+        }
+    };
+
+    update(move, bonus);
+    for (const auto &quiet : quiets_tried)
+    {
+        update(quiet, -bonus);
+    }
+}
+
+void Worker::makeMove(int ply, Move move)
+{
+    if (copy_make_)
+    {
+        board.save(snapshots_[ply]);
+    }
+    board.makeMove(move);
+}
+
+void Worker::unmakeMove(int ply, Move move)
+{
+    if (copy_make_)
+    {
+        board.restore(snapshots_[ply]);
+    }
+    else
+    {
+        board.unmakeMove(move);
+    }
+}
+
+PieceToHistory *Worker::continuationAt(int ply)
+{
+    // nothing before the root, and a null move has no follow-ups worth learning
+    if (ply < 0 || stack[ply].piece == Piece::NONE)
+    {
+        return nullptr;
+    }
+    return &continuation_history[stack[ply].piece][stack[ply].move.to().index()];
+}
+
+int Worker::quietHistory(Move move, const std::array<const PieceToHistory *, 2> &continuation) const
+{
+    int score = history[board.sideToMove()][move.from().index()][move.to().index()];
+    for (const auto *table : continuation)
+    {
+        if (table)
+        {
+            score += (*table)[board.at(move.from())][move.to().index()];
+        }
+    }
+    return score;
+}
+
+void Worker::clear()
+{
+    for (auto &side : history)
+    {
+        for (auto &from : side)
+        {
+            from.fill(0);
+        }
+    }
+    for (auto &piece : continuation_history)
+    {
+        for (auto &to : piece)
+        {
+            for (auto &table : to)
+            {
+                table.fill(0);
+            }
+        }
+    }
+    for (auto &piece : countermoves)
+    {
+        piece.fill(Move::NO_MOVE);
+    }
+    eval_cache.clear();
+}
@@ -0,0 +1,118 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "chess.hpp"
+#include "evaluate.hpp"
+#include "movepick.hpp"
+#include "tt.hpp"
+#include "types.hpp"
+
+struct BestMove
+{
+    chess::Move move;
+    int eval;
+    chess::Movelist pv = {}; // starts with move
+};
+
+// Everything "go" can ask for. Zero means the limit was not given.
+struct SearchLimits
+{
+    std::array<int, 2> time = {}; // remaining time per color in ms
+    std::array<int, 2> inc = {};
+    int movestogo = 0;
+    int movetime = 0;
+    int depth = DEPTH;
+    uint64_t nodes = 0;
+    int mate = 0;        // stop once a mate is found
+    bool timed = false;    // wtime or btime was given, even if it reads 0
+    bool infinite = false; // keep searching until "stop", even past the depth limit
+    std::chrono::time_point<std::chrono::high_resolution_clock> start;
+};
+
+// Search state of a single ply, indexed by the distance from the root.
+struct StackEntry
+{
+    chess::Move move = chess::Move::NO_MOVE;
+    chess::Piece piece = chess::Piece::NONE; // the piece that played move
+    chess::Move killers[2] = {chess::Move::NO_MOVE, chess::Move::NO_MOVE};
+
+    // Triangular PV table: the best line found from this ply on, built from the next ply's line.
+    std::array<chess::Move, MAX_PLY + 1> pv;
+    int pv_length = 0;
+};
+
+// Everything one search thread owns. Only the transposition table is shared between threads.
+class Worker
+{
+public:
+    explicit Worker(size_t id) : id(id) {}
+
+    // Forgets everything learned about move ordering, for a new game.
+    void clear();
+
+    // Runs iterative deepening on board. The main thread also stops and collects the helpers.
+    void search(const SearchLimits &limits);
+
+    bool isMainThread() const { return id == 0; }
+
+    const size_t id;
+    EvalBoard board;
+    std::array<StackEntry, MAX_PLY + 1> stack;
+    std::atomic<uint64_t> nodes = 0;
+
+    // move ordering, only ever touched by this thread
+    ButterflyHistory history = {};
+    ContinuationHistory continuation_history = {};
+    CounterMoveTable countermoves = {};
+
+    PawnTable pawn_table;
+    EvalCache eval_cache;
+
+    // beta cutoffs, and how many of them came from the first move searched
+    uint64_t cutoffs = 0;
+    uint64_t first_move_cutoffs = 0;
+
+    // Result of the deepest fully searched iteration.
+    BestMove best = {.move = chess::Move::NO_MOVE, .eval = -INF};
+    int completed_depth = 0;
+    int seldepth = 0; // deepest ply reached, quiescence included
+
+private:
+    void findBestMove(const SearchLimits &limits);
+    int searchRoot(chess::Movelist &moves, int depth, int alpha, int beta, chess::Move &best_move);
+    bool checkStop();
+    int negamax(int depth, int ply, int alpha, int beta);
+    int quiescence(int ply, int alpha, int beta, int qs_ply = 0); // qs_ply: plies since quiescence began
+    bool isDraw() const; // by repetition or the fifty-move rule
+    int staticEval(); // from the side to move's point of view
+    int staticEval(bool tt_hit, const TTData &tt_entry); // sharpened by the TT score on a hit
+    void updatePv(int ply, chess::Move move);
+    void makeMove(int ply, chess::Move move);
+    void unmakeMove(int ply, chess::Move move);
+    PieceToHistory *continuationAt(int ply);
+    int quietHistory(chess::Move move, const std::array<const PieceToHistory *, 2> &continuation) const;
+    void updateQuietStats(int ply, int depth, chess::Move move, const chess::Movelist &quiets_tried);
+
+    // threads.stop as of the last check, every node of a stopped search returns right away
+    bool stopped_ = false;
+    int calls_until_check_ = 0;
+
+    // no null moves before this ply while a null move fail high is being verified
+    int nmp_min_ply_ = 0;
+
+    // copy-make: the position before the move made at each ply, restored to undo it
+    bool copy_make_ = false;
+    std::array<EvalBoard::Snapshot, MAX_PLY + 1> snapshots_;
+};
+
+// Wall time of every finished search in ms, printed on quit.
+extern std::vector<int64_t> movetimes;
+
+#endif
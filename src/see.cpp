@@ -0,0 +1,143 @@
+#include "see.hpp"
+
+#include "evaluate.hpp"
+
+using namespace chess;
+
+bool see(const Board &board, Move move, int threshold)
+{
+    // castling can't lose material, and the rook landing on its square is no capture
+    if (move.typeOf() == Move::CASTLING)
+    {
+        return threshold <= 0;
+    }
+
+    const auto from = move.from();
+    const auto to = move.to();
+    const bool promotion = move.typeOf() == Move::PROMOTION;
+
+    // what the move wins outright, minus what we need
+    int swap = (move.typeOf() == Move::ENPASSANT ? PIECE_VALUE[PieceType(PieceType::PAWN)] : PIECE_VALUE[board.at<PieceType>(to)]) - threshold;
+    if (promotion)
+    {
+        swap += PIECE_VALUE[move.promotionType()] - PIECE_VALUE[PieceType(PieceType::PAWN)];
+    }
+    if (swap < 0)
+    {
+        return false;
+    }
+
+    // the captured piece leaves to, which makes no difference to what attacks it
+    auto occupied = board.occ() ^ Bitboard::fromSquare(from) ^ Bitboard::fromSquare(to);
+    if (move.typeOf() == Move::ENPASSANT)
+    {
+        occupied ^= Bitboard::fromSquare(to.ep_square());
+    }
+
+    const auto diagonal = board.pieces(PieceType::BISHOP) | board.pieces(PieceType::QUEEN);
+    const auto straight = board.pieces(PieceType::ROOK) | board.pieces(PieceType::QUEEN);
+
+    auto attackers = (attacks::pawn(Color::BLACK, to) & board.pieces(PieceType::PAWN, Color::WHITE)) |
+                     (attacks::pawn(Color::WHITE, to) & board.pieces(PieceType::PAWN, Color::BLACK)) |
+                     (attacks::knight(to) & board.pieces(PieceType::KNIGHT)) |
+                     (attacks::bishop(to, occupied) & diagonal) | (attacks::rook(to, occupied) & straight) |
+                     (attacks::king(to) & board.pieces(PieceType::KING));
+
+    const auto &info = board.checkInfo();
+
+    // A pawn taking on its last rank promotes, so whoever stands on to stands to lose the
+    // promotion gain as well. Pawns are always the first to recapture, and only one side
+    // can ever promote on to.
+    const int promotion_gain = PIECE_VALUE[PieceType(PieceType::QUEEN)] - PIECE_VALUE[PieceType(PieceType::PAWN)];
+    const auto recapturePromotes = [&](Color side)
+    {
+        if (!Square::back_rank(to, ~side))
+        {
+            return false;
+        }
+        auto pawns = attackers & occupied & board.pieces(PieceType::PAWN, side);
+        if (info.pinners[side] & occupied)
+        {
+            pawns &= ~info.blockers[side];
+        }
+        return static_cast<bool>(pawns);
+    };
+
+    auto side = board.at(from).color();
+    bool result = true; // whether the side that made the move comes out ahead if nobody else captures
+
+    // even losing the piece on to for nothing still meets the threshold
+    swap = (promotion ? PIECE_VALUE[move.promotionType()] : PIECE_VALUE[board.at<PieceType>(from)]) - swap;
+    if (recapturePromotes(~side))
+    {
+        swap += promotion_gain;
+    }
+    if (swap <= 0)
+    {
+        return true;
+    }
+
+    while (true)
+    {
+        side = ~side;
+        attackers &= occupied;
+
+        auto our_attackers = attackers & board.us(side);
+
+        // pinned pieces stay put while whatever pins them is still on the board
+        if (info.pinners[side] & occupied)
+        {
+            our_attackers &= ~info.blockers[side];
+        }
+        if (!our_attackers)
+        {
+            break;
+        }
+
+        // the least valuable attacker recaptures
+        PieceType type = PieceType::NONE;
+        Bitboard candidates;
+        for (const auto candidate : {PieceType::PAWN, PieceType::KNIGHT, PieceType::BISHOP, PieceType::ROOK,
+                                     PieceType::QUEEN, PieceType::KING})
+        {
+            candidates = our_attackers & board.pieces(candidate);
+            if (candidates)
+            {
+                type = candidate;
+                break;
+            }
+        }
+
+        // a king can only recapture if nothing is left to take it back
+        if (type == PieceType::KING)
+        {
+            return (attackers & ~board.us(side)) ? result : !result;
+        }
+
+        result = !result;
+        const bool promotes = type == PieceType::PAWN && Square::back_rank(to, ~side);
+        swap = (promotes ? PIECE_VALUE[PieceType(PieceType::QUEEN)] : PIECE_VALUE[type]) - swap;
+        if (recapturePromotes(~side))
+        {
+            swap += promotion_gain;
+        }
+        if (swap < static_cast<int>(result))
+        {
+            break;
+        }
+
+        occupied ^= Bitboard::fromSquare(candidates.lsb());
+
+        // whatever stood behind the recapturing piece now sees the square
+        if (type == PieceType::PAWN || type == PieceType::BISHOP || type == PieceType::QUEEN)
+        {
+            attackers |= attacks::bishop(to, occupied) & diagonal;
+        }
+        if (type == PieceType::ROOK || type == PieceType::QUEEN)
+        {
+            attackers |= attacks::rook(to, occupied) & straight;
+        }
+    }
+
+    return result;
+}
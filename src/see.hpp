@@ -0,0 +1,13 @@
+#ifndef SEE_HPP
+#define SEE_HPP
+
+#include "chess.hpp"
+
+// Static exchange evaluation: whether move wins at least threshold centipawns once every
+// piece that can recapture on its target square has had the chance to, least valuable
+// first and either side stopping whenever going on would lose. Sliders behind the pieces
+// that have moved join in as x-rays. Pieces pinned to their king don't recapture while
+// the pinner is still on the board.
+bool see(const chess::Board &board, chess::Move move, int threshold);
+
+#endif
@@ -0,0 +1,148 @@
+#include "thread.hpp"
+
+#include "timeman.hpp"
+
+using namespace chess;
+
+ThreadPool threads;
+
+std::mutex io_mutex;
+
+SearchThread::SearchThread(size_t id) : worker(id), thread_(&SearchThread::idleLoop, this)
+{
+    waitForSearchFinished();
+}
+
+SearchThread::~SearchThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exit_ = true;
+        searching_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+void SearchThread::startSearching()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        searching_ = true;
+    }
+    cv_.notify_all();
+}
+
+void SearchThread::waitForSearchFinished()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return !searching_; });
+}
+
+void SearchThread::idleLoop()
+{
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        searching_ = false;
+        cv_.notify_all(); // wake up waitForSearchFinished
+        cv_.wait(lock, [&] { return searching_; });
+
+        if (exit_)
+        {
+            return;
+        }
+
+        lock.unlock();
+        worker.search(threads.limits);
+    }
+}
+
+void ThreadPool::resize(size_t count)
+{
+    if (!threads_.empty())
+    {
+        main().waitForSearchFinished();
+    }
+
+    threads_.clear();
+    for (size_t id = 0; id < std::max<size_t>(1, count); ++id)
+    {
+        threads_.push_back(std::make_unique<SearchThread>(id));
+    }
+}
+
+void ThreadPool::startSearch(const Board &board, const SearchLimits &search_limits)
+{
+    main().waitForSearchFinished();
+
+    stop = false;
+    limits = search_limits;
+    time_manager.init(limits, board.sideToMove());
+
+    for (auto &thread : threads_)
+    {
+        auto &worker = thread->worker;
+        worker.board = board;
+        worker.nodes = 0;
+        worker.completed_depth = 0;
+        worker.cutoffs = 0;
+        worker.first_move_cutoffs = 0;
+        worker.pawn_table.hits = 0;
+        worker.pawn_table.probes = 0;
+        worker.eval_cache.hits = 0;
+        worker.eval_cache.probes = 0;
+        worker.stack = {};
+        worker.best = {.move = Move::NO_MOVE, .eval = -INF};
+    }
+
+    for (auto &thread : threads_)
+    {
+        thread->startSearching();
+    }
+}
+
+void ThreadPool::clear()
+{
+    main().waitForSearchFinished();
+
+    for (auto &thread : threads_)
+    {
+        thread->worker.clear();
+    }
+}
+
+void ThreadPool::waitForHelpers()
+{
+    for (size_t i = 1; i < threads_.size(); ++i)
+    {
+        threads_[i]->waitForSearchFinished();
+    }
+}
+
+const Worker &ThreadPool::bestThread() const
+{
+    const Worker *best = &threads_.front()->worker;
+
+    for (const auto &thread : threads_)
+    {
+        const auto &worker = thread->worker;
+        if (worker.completed_depth > best->completed_depth ||
+            (worker.completed_depth == best->completed_depth && worker.best.eval > best->best.eval))
+        {
+            best = &worker;
+        }
+    }
+
+    return *best;
+}
+
+uint64_t ThreadPool::nodesSearched() const
+{
+    uint64_t nodes = 0;
+    for (const auto &thread : threads_)
+    {
+        nodes += thread->worker.nodes.load(std::memory_order_relaxed);
+    }
+    return nodes;
+}
@@ -0,0 +1,74 @@
+#ifndef THREAD_HPP
+#define THREAD_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "chess.hpp"
+#include "search.hpp"
+
+// A persistent OS thread that sleeps until it is handed a search.
+class SearchThread
+{
+public:
+    explicit SearchThread(size_t id);
+    ~SearchThread();
+
+    void startSearching();
+    void waitForSearchFinished();
+
+    Worker worker;
+
+private:
+    void idleLoop();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool searching_ = true;
+    bool exit_ = false;
+    std::thread thread_; // started last, after everything idleLoop touches
+};
+
+// Lazy SMP: every thread searches the same root on its own board copy and
+// they only cooperate through the shared transposition table.
+class ThreadPool
+{
+public:
+    void resize(size_t count);
+    size_t size() const { return threads_.size(); }
+
+    SearchThread &main() { return *threads_.front(); }
+
+    // Resets the move ordering tables of every thread, for ucinewgame.
+    void clear();
+
+    void startSearch(const chess::Board &board, const SearchLimits &limits);
+    void waitForHelpers();
+
+    // Deepest completed iteration over all threads, higher score on ties.
+    const Worker &bestThread() const;
+    uint64_t nodesSearched() const;
+
+    std::atomic<bool> stop = false;
+    SearchLimits limits = {};
+
+    // Undo moves by restoring a copy of the position saved before them instead of
+    // unmakeMove, option "CopyMake". Which one is faster depends on the machine, see bench.
+    bool copy_make = false;
+
+private:
+    std::vector<std::unique_ptr<SearchThread>> threads_;
+};
+
+extern ThreadPool threads;
+
+// Held while writing to stdout, so lines from the UCI and the search thread never interleave.
+extern std::mutex io_mutex;
+
+#endif
@@ -0,0 +1,97 @@
+#include "timeman.hpp"
+
+#include <algorithm>
+
+#include "search.hpp"
+
+using namespace chess;
+
+TimeManager time_manager;
+
+namespace
+{
+    // Assumed number of moves left when the GUI doesn't send movestogo.
+    constexpr int DEFAULT_MOVES_TO_GO = 30;
+    constexpr int MAX_MOVES_TO_GO = 50;
+
+    // The hard limit is this many times the soft one, and never more than this share of the clock.
+    constexpr int MAX_SOFT_MULTIPLIER = 5;
+    constexpr double MAX_CLOCK_SHARE = 0.8;
+
+    // Iterations in a row with the same best move before the time saving stops growing.
+    constexpr int MAX_STABILITY = 4;
+}
+
+void TimeManager::init(const SearchLimits &limits, Color us)
+{
+    start_ = limits.start;
+    scale_ = 1.0;
+    last_best_move_ = Move::NO_MOVE;
+    best_move_stability_ = 0;
+    has_last_score_ = false;
+
+    const int time = limits.time[us];
+    const int inc = limits.inc[us];
+
+    // an empty clock still gets the minimal budget below rather than no limit at all
+    enabled_ = !limits.infinite && (limits.movetime > 0 || limits.timed);
+    if (!enabled_)
+    {
+        return;
+    }
+
+    fixed_ = limits.movetime > 0;
+    if (fixed_)
+    {
+        // fixed time per move, nothing to adjust
+        optimum_ = maximum_ = std::max(1, limits.movetime - move_overhead);
+        return;
+    }
+
+    const int64_t available = std::max(1, time - move_overhead);
+    const int64_t moves_to_go = limits.movestogo > 0 ? std::min(limits.movestogo, MAX_MOVES_TO_GO) : DEFAULT_MOVES_TO_GO;
+
+    maximum_ = static_cast<int64_t>(available * MAX_CLOCK_SHARE);
+    optimum_ = std::min(available / moves_to_go + inc * 3 / 4, maximum_);
+    maximum_ = std::max<int64_t>(1, std::min(optimum_ * MAX_SOFT_MULTIPLIER, maximum_));
+}
+
+void TimeManager::update(Move best_move, int score)
+{
+    if (!enabled_ || fixed_)
+    {
+        return;
+    }
+
+    best_move_stability_ = best_move == last_best_move_ ? std::min(best_move_stability_ + 1, MAX_STABILITY) : 0;
+    last_best_move_ = best_move;
+
+    // 1.3 right after a change of mind, down to 0.7 after MAX_STABILITY identical iterations
+    const double stability_factor = 1.3 - 0.15 * best_move_stability_;
+
+    // every 100 cp lost since the last iteration is worth another half of the budget
+    double score_factor = 1.0;
+    if (has_last_score_)
+    {
+        score_factor = std::clamp(1.0 + (last_score_ - score) / 200.0, 0.8, 1.5);
+    }
+    last_score_ = score;
+    has_last_score_ = true;
+
+    scale_ = stability_factor * score_factor;
+}
+
+bool TimeManager::softLimitReached() const
+{
+    return enabled_ && elapsed() >= std::min<int64_t>(optimum_ * scale_, maximum_);
+}
+
+bool TimeManager::hardLimitReached() const
+{
+    return enabled_ && elapsed() >= maximum_;
+}
+
+int64_t TimeManager::elapsed() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start_).count();
+}
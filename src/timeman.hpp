@@ -0,0 +1,50 @@
+#ifndef TIMEMAN_HPP
+#define TIMEMAN_HPP
+
+#include <chrono>
+#include <cstdint>
+
+#include "chess.hpp"
+
+struct SearchLimits;
+
+// Decides how long a "go" may think. The soft limit is checked between iterations,
+// the hard limit is polled inside the search and aborts it.
+class TimeManager
+{
+public:
+    static constexpr int DEFAULT_MOVE_OVERHEAD = 10;
+    static constexpr int MAX_MOVE_OVERHEAD = 5000;
+
+    // Computes the budget of a new search for the side to move.
+    void init(const SearchLimits &limits, chess::Color us);
+
+    // Called after every completed iteration of the main thread. A best move that
+    // keeps changing or a falling score earns more time, a stable one less.
+    void update(chess::Move best_move, int score);
+
+    bool softLimitReached() const;
+    bool hardLimitReached() const;
+
+    int64_t elapsed() const;
+
+    // Time lost per move to the GUI and the network, in ms.
+    int move_overhead = DEFAULT_MOVE_OVERHEAD;
+
+private:
+    std::chrono::time_point<std::chrono::high_resolution_clock> start_;
+    bool enabled_ = false; // false for depth, nodes, mate and infinite searches
+    bool fixed_ = false;   // movetime: the whole budget is used, stability and score don't matter
+    int64_t optimum_ = 0;  // soft limit in ms before scaling
+    int64_t maximum_ = 0;  // hard limit in ms
+    double scale_ = 1.0;
+
+    chess::Move last_best_move_ = chess::Move::NO_MOVE;
+    int best_move_stability_ = 0;
+    int last_score_ = 0;
+    bool has_last_score_ = false;
+};
+
+extern TimeManager time_manager;
+
+#endif
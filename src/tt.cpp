@@ -0,0 +1,138 @@
+#include "tt.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace chess;
+
+TranspositionTable transposition_table;
+
+void TranspositionTable::resize(size_t mb, size_t threads)
+{
+    mb = std::clamp<size_t>(mb, 1, MAX_MB);
+
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= mb * 1024 * 1024)
+    {
+        count *= 2;
+    }
+
+    buckets_.reset(); // free the old table first so both never coexist
+    buckets_.reset(new Bucket[count]); // left uninitialised, clear() zeroes it in parallel
+    bucket_count_ = count;
+    clear(threads);
+}
+
+void TranspositionTable::clear(size_t threads)
+{
+    threads = std::max<size_t>(1, threads);
+
+    const size_t chunk = bucket_count_ / threads;
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < threads; ++i)
+    {
+        const size_t start = i * chunk;
+        const size_t count = i == threads - 1 ? bucket_count_ - start : chunk;
+        workers.emplace_back([this, start, count]
+                             { std::memset(static_cast<void *>(&buckets_[start]), 0, count * sizeof(Bucket)); });
+    }
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    generation_ = 0;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTData &data) const
+{
+    const auto &bucket = bucketFor(key);
+    const auto key16 = keyFor(key);
+
+    for (const auto &slot : bucket.entries)
+    {
+        const TTEntry entry = slot.load(std::memory_order_relaxed);
+        if (entry.key == key16 && entry.flag() != EntryFlag::NONE)
+        {
+            data.move = Move(entry.move);
+            data.score = entry.score;
+            data.depth = entry.depth - DEPTH_OFFSET;
+            data.flag = entry.flag();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int score, EntryFlag flag, Move move)
+{
+    auto &bucket = bucketFor(key);
+    const auto key16 = keyFor(key);
+
+    // Take the slot already holding this position or an empty one, otherwise evict
+    // the entry with the least remaining depth, counting every search of age as 8 plies.
+    int index = 0;
+    TTEntry replace = bucket.entries[0].load(std::memory_order_relaxed);
+    for (int i = 0; i < BUCKET_SIZE; ++i)
+    {
+        const TTEntry entry = bucket.entries[i].load(std::memory_order_relaxed);
+        if (entry.flag() == EntryFlag::NONE || entry.key == key16)
+        {
+            index = i;
+            replace = entry;
+            break;
+        }
+        if (entry.depth - 8 * age(entry) < replace.depth - 8 * age(replace))
+        {
+            index = i;
+            replace = entry;
+        }
+    }
+
+    const bool same_position = replace.flag() != EntryFlag::NONE && replace.key == key16;
+
+    // Don't let a shallow bound from this search overwrite a deeper result for the same position.
+    if (same_position && flag != EntryFlag::EXACT && age(replace) == 0 &&
+        depth + DEPTH_OFFSET + 2 < replace.depth)
+    {
+        return;
+    }
+
+    // Keep the old best move when this search didn't produce one.
+    if (move != Move::NO_MOVE || !same_position)
+    {
+        replace.move = move.move();
+    }
+
+    replace.key = key16;
+    replace.score = static_cast<int16_t>(score);
+    replace.depth = static_cast<uint8_t>(std::max(depth + DEPTH_OFFSET, 0));
+    replace.gen_flag = generation_ | static_cast<uint8_t>(flag);
+
+    bucket.entries[index].store(replace, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+    const size_t samples = std::min<size_t>(1000 / BUCKET_SIZE, bucket_count_);
+    int used = 0;
+
+    for (size_t i = 0; i < samples; ++i)
+    {
+        for (const auto &slot : buckets_[i].entries)
+        {
+            const TTEntry entry = slot.load(std::memory_order_relaxed);
+            if (entry.flag() != EntryFlag::NONE && entry.generation() == generation_)
+            {
+                ++used;
+            }
+        }
+    }
+
+    return used * 1000 / static_cast<int>(samples * BUCKET_SIZE);
+}
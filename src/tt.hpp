@@ -0,0 +1,96 @@
+#ifndef TT_HPP
+#define TT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "chess.hpp"
+
+enum class EntryFlag : uint8_t
+{
+    NONE, // empty slot
+    EXACT,
+    LOWER_BOUND,
+    UPPER_BOUND
+};
+
+// Packed to 8 bytes so that a bucket of eight entries fills exactly one cache line.
+struct TTEntry
+{
+    uint16_t key;      // upper 16 bits of the zobrist hash, the lower bits select the bucket
+    uint16_t move;     // best move found, Move::NO_MOVE if none
+    int16_t score;     // search score, no static eval: there are no bits left for one
+    uint8_t depth;     // remaining depth + DEPTH_OFFSET, so that quiescence depths fit too
+    uint8_t gen_flag;  // generation in the upper 6 bits, EntryFlag in the lower 2
+
+    EntryFlag flag() const { return static_cast<EntryFlag>(gen_flag & 0x3); }
+    uint8_t generation() const { return gen_flag & ~0x3; }
+};
+
+static_assert(sizeof(TTEntry) == 8);
+static_assert(std::atomic<TTEntry>::is_always_lock_free);
+
+// What a successful probe hands back to the search.
+struct TTData
+{
+    chess::Move move;
+    int score;
+    int depth;
+    EntryFlag flag;
+};
+
+class TranspositionTable
+{
+public:
+    static constexpr size_t DEFAULT_MB = 16;
+    static constexpr size_t MAX_MB = 65536;
+
+    // Reallocates the table to the largest power-of-two bucket count fitting into mb megabytes.
+    void resize(size_t mb, size_t threads);
+
+    // Zeroes the table, splitting the work between the given number of threads.
+    void clear(size_t threads);
+
+    // Called once per "go", so that entries from previous searches age out.
+    void newSearch() { generation_ += GENERATION_STEP; }
+
+    bool probe(uint64_t key, TTData &data) const;
+    void store(uint64_t key, int depth, int score, EntryFlag flag, chess::Move move);
+
+    // Permill of sampled entries written during the current search, for "info hashfull".
+    int hashfull() const;
+
+private:
+    static constexpr int BUCKET_SIZE = 8;
+    static constexpr int DEPTH_OFFSET = 8;
+    static constexpr uint8_t GENERATION_STEP = 0x4; // the lower 2 bits hold the flag
+    static constexpr int GENERATION_CYCLE = 0x100;
+
+    // Each entry is read and written as a single lock-free word, so search threads can
+    // share the table without locks and without ever seeing a torn entry.
+    struct alignas(64) Bucket
+    {
+        std::atomic<TTEntry> entries[BUCKET_SIZE];
+    };
+
+    static_assert(sizeof(Bucket) == 64);
+
+    Bucket &bucketFor(uint64_t key) const { return buckets_[key & (bucket_count_ - 1)]; }
+    static uint16_t keyFor(uint64_t key) { return static_cast<uint16_t>(key >> 48); }
+
+    // How many searches ago the entry was written.
+    int age(const TTEntry &entry) const
+    {
+        return ((GENERATION_CYCLE + generation_ - entry.generation()) & 0xFC) / GENERATION_STEP;
+    }
+
+    std::unique_ptr<Bucket[]> buckets_;
+    size_t bucket_count_ = 0;
+    uint8_t generation_ = 0;
+};
+
+extern TranspositionTable transposition_table;
+
+#endif
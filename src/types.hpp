@@ -0,0 +1,34 @@
+#ifndef TYPES_HPP
+#define TYPES_HPP
+
+constexpr auto DRAW_SCORE = 0;
+constexpr auto INF = 32000; // has to fit the 16 bit score field of the transposition table
+constexpr auto DEPTH = 32;  // half-moves
+constexpr auto MAX_PLY = 128;
+
+// Every score lies in [-INF, INF]. Being mated n plies from the root scores -(MATE - n),
+// so the search prefers the shortest mate and the longest defence.
+constexpr auto MATE = 31000;
+constexpr auto MATE_IN_MAX_PLY = MATE - MAX_PLY; // scores beyond this are mates
+
+constexpr int mateIn(int ply) { return MATE - ply; }
+constexpr int matedIn(int ply) { return -MATE + ply; }
+
+constexpr bool isMateScore(int score)
+{
+    return (score >= MATE_IN_MAX_PLY && score <= MATE) || (score <= -MATE_IN_MAX_PLY && score >= -MATE);
+}
+
+// The transposition table holds mate scores relative to the stored node instead of the root,
+// because the same position is reached at different plies.
+constexpr int scoreToTT(int score, int ply)
+{
+    return score >= MATE_IN_MAX_PLY ? score + ply : score <= -MATE_IN_MAX_PLY ? score - ply : score;
+}
+
+constexpr int scoreFromTT(int score, int ply)
+{
+    return score >= MATE_IN_MAX_PLY ? score - ply : score <= -MATE_IN_MAX_PLY ? score + ply : score;
+}
+
+#endif